@@ -0,0 +1,158 @@
+#version 330
+// lights the G-buffer, see DeferredLightingPass.hpp.
+// the lighting is the same as Phong.fs, only read from the G-buffer a pixel at a time
+layout(location = 0) out vec4 litColour;        // rgb: ambient, diffuse and specular, a: transparency
+layout(location = 1) out vec4 diffuseColour;    // rgb: ambient and diffuse only, for cel shading
+
+uniform sampler2D gPosition;
+uniform sampler2D gNormal;
+uniform sampler2D gAlbedo;
+uniform sampler2D gSpecular;
+
+// LIGHTS, the blocks are shared by every pass, must match SceneUniforms.hpp
+layout(std140) uniform Camera {
+	mat4 View;
+	mat4 Perspective;
+	vec3 viewPosition;
+};
+
+uniform int shadowsEnabled;
+uniform sampler2D shadowMap;
+
+// NR_POINT_LIGHTS is defined by the program
+struct DirectionalLight {
+    vec3 direction;
+    vec3 rgbIntensity;
+};
+struct LightSource {
+    vec3 position;
+    vec3 rgbIntensity;
+    vec3 attenuationVals;
+};
+layout(std140) uniform Lights {
+    DirectionalLight directionalLight;
+    vec3 dirLightPos;
+    int numPointLights;
+    mat4 dirLightSpaceMatrix;
+    ivec4 clusterDims;      // tiles in x and y, depth slices in z
+    vec4 clusterDepth;      // near, far, slice scale
+    LightSource pointLights[NR_POINT_LIGHTS];
+};
+
+uniform vec3 ambientIntensity;
+
+// CLUSTERS, see LightClusters.hpp
+uniform usamplerBuffer clusterGrid;
+uniform usamplerBuffer clusterIndices;
+
+// diffuse and specular are kept apart, cel shading only wants the diffuse
+struct Lighting {
+    vec3 diffuse;
+    vec3 specular;
+};
+
+Lighting phongModelperPointLight(
+    vec3 fragPosition, 
+    vec3 fragNormal,
+    LightSource light, 
+    vec3 viewDir,
+	vec3 kd,
+	vec4 ks
+) {
+	// end early if light not on
+	if (light.rgbIntensity == vec3(0)) { return Lighting(vec3(0), vec3(0)); }
+
+    // calculate attenuation
+    float d = length(light.position - fragPosition);
+    vec3 a = light.attenuationVals;
+    float attenuation = 1.0/(a[0] + a[1]*d + a[2]*d*d);
+
+    // Direction from fragment to light source.
+    vec3 lightDir = normalize(light.position - fragPosition);
+    
+    float n_dot_l = max(dot(fragNormal, lightDir), 0.0);
+	vec3 diffuse = kd * n_dot_l * attenuation;
+	vec3 reflectDir = reflect(-lightDir, fragNormal);
+	float spec = pow(max(dot(viewDir, reflectDir), 0.0), ks[3]);
+	vec3 specular = vec3(ks) * spec * attenuation;
+
+    return Lighting(light.rgbIntensity * diffuse, light.rgbIntensity * specular);
+}
+
+float dirLightShadowCalculation(vec3 fragPosition, vec3 fragNormal) {
+	if (shadowsEnabled == 0) { return 0.0; }
+    vec4 fragPosDirLightSpace = dirLightSpaceMatrix * vec4(fragPosition, 1.0);
+    vec3 projCoords = fragPosDirLightSpace.xyz / fragPosDirLightSpace.w;
+    projCoords = projCoords * 0.5 + 0.5;
+    // keep the shadow at 0.0 when outside the far_plane region of the light's frustum.
+    if (projCoords.z > 1.0) { return 0.0; }
+
+    float closestDepth = texture(shadowMap, projCoords.xy).r; 
+    vec3 normal = normalize(fragNormal);
+    vec3 lightDir = normalize(dirLightPos - fragPosition);
+    float bias = max(0.02 * (1.0 - dot(normal, lightDir)), 0.01);
+    // a single sample, Phong.fs throws its PCF result away too
+    return projCoords.z - bias > closestDepth ? 1.0 : 0.0;
+}
+
+Lighting phongModelforDirectionalLight(
+    vec3 fragPosition, 
+    vec3 fragNormal,
+    vec3 viewDir,
+	vec3 kd,
+	vec4 ks
+) {
+    vec3 lightDir = normalize(-directionalLight.direction);
+    float n_dot_l = max(dot(fragNormal, lightDir), 0.0);
+
+	vec3 diffuse = kd * n_dot_l;
+	vec3 reflectDir = reflect(-lightDir, fragNormal);
+	float spec = pow(max(dot(viewDir, reflectDir), 0.0), ks[3]);
+	vec3 specular = vec3(ks) * spec;
+
+    vec3 lit = directionalLight.rgbIntensity * (1 - dirLightShadowCalculation(fragPosition, fragNormal));
+    return Lighting(lit * diffuse, lit * specular);
+}
+
+// returns the index offset, number of point lights and number of lanterns
+// of the cluster the fragment is in
+uvec3 getCluster(vec3 fragPosition) {
+    vec4 viewSpacePos = View * vec4(fragPosition, 1.0);
+    vec4 clipPos = Perspective * viewSpacePos;
+    vec2 ndc = clipPos.xy / clipPos.w;
+    float depth = max(-viewSpacePos.z, clusterDepth.x);
+
+    int x = clamp(int((ndc.x*0.5 + 0.5) * clusterDims.x), 0, clusterDims.x - 1);
+    int y = clamp(int((ndc.y*0.5 + 0.5) * clusterDims.y), 0, clusterDims.y - 1);
+    int z = clamp(int(log(depth / clusterDepth.x) * clusterDepth.z), 0, clusterDims.z - 1);
+    uvec2 cell = texelFetch(clusterGrid, x + clusterDims.x*(y + clusterDims.y*z)).rg;
+    return uvec3(cell.x, cell.y >> 16u, cell.y & 0xFFFFu);
+}
+
+void main() {
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    vec4 normalAndId = texelFetch(gNormal, pixel, 0);
+    // nothing was drawn here
+    if (normalAndId.w == 0) { discard; }
+
+    vec3 fragPos = texelFetch(gPosition, pixel, 0).xyz;
+    vec3 normal = normalAndId.xyz;
+    vec4 albedo = texelFetch(gAlbedo, pixel, 0);
+    vec4 ks = texelFetch(gSpecular, pixel, 0);
+    vec3 kd = albedo.rgb;
+    vec3 viewDir = normalize(viewPosition - fragPos);
+
+    // directional light first
+    Lighting total = phongModelforDirectionalLight(fragPos, normal, viewDir, kd, ks);
+	// only the point lights that reach this cluster
+    uvec3 cluster = getCluster(fragPos);
+    for (uint i=0u; i<cluster.y; i++) {
+        int lightIndex = int(texelFetch(clusterIndices, int(cluster.x + i)).r);
+        Lighting light = phongModelperPointLight(fragPos, normal, pointLights[lightIndex], viewDir, kd, ks);
+        total.diffuse += light.diffuse;
+        total.specular += light.specular;
+    }
+
+    litColour = vec4(ambientIntensity + total.diffuse + total.specular, albedo.a);
+    diffuseColour = vec4(ambientIntensity + total.diffuse, albedo.a);
+}
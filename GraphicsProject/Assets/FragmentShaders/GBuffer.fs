@@ -0,0 +1,41 @@
+#version 330
+// writes the surfaces for the deferred renderer, see GBufferShader.hpp
+in VsOutFsIn {
+	vec3 fragPos; 
+	vec3 normal;  
+	vec2 texCoords;
+    vec4 fragPosDirLightSpace; 
+} fs_in;
+
+// must match the GBUFFER_* attachments
+layout(location = 0) out vec4 gPosition;    // xyz: world position
+layout(location = 1) out vec4 gNormal;      // xyz: normal, w: material id, 0 where nothing was drawn
+layout(location = 2) out vec4 gAlbedo;      // rgb: kd, a: transparency
+layout(location = 3) out vec4 gSpecular;    // rgb: ks, a: shininess
+
+// TEXTURES AND MATERIALS, same as Phong.fs
+#define MATERIAL_PLAIN 0
+#define MATERIAL_TEXTURE 1
+uniform int materialType;
+struct Material {
+    vec4 kd;			// last element transparency
+    vec3 ks;
+    float shininess;
+};
+uniform Material material;
+uniform sampler2D colourTexture;
+
+void main() {
+    gPosition = vec4(fs_in.fragPos, 1);
+    // the normal is left as interpolated, like Phong.fs uses it
+    gNormal = vec4(fs_in.normal, materialType + 1);
+	if (materialType == MATERIAL_PLAIN) {
+        gAlbedo = material.kd;
+        gSpecular = vec4(material.ks, material.shininess);
+	} 
+	else {
+        gAlbedo = texture(colourTexture, fs_in.texCoords);
+		// no specular for now
+        gSpecular = vec4(0, 0, 0, 1);
+	}
+}
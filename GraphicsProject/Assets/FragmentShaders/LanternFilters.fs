@@ -0,0 +1,148 @@
+#version 330
+// applies the lantern filters to the lit G-buffer, see LanternFilterPass.hpp.
+// the filters and the glow at the edge of each radius are the same as Phong.fs
+out vec4 fragColour;
+
+uniform sampler2D litColour;        // rgb: the full phong colour, a: transparency
+uniform sampler2D diffuseColour;    // rgb: without specular, for cel shading
+uniform sampler2D gPosition;
+uniform sampler2D gNormal;          // w: material id, 0 where nothing was drawn
+
+// the blocks are shared by every pass, must match SceneUniforms.hpp
+layout(std140) uniform Camera {
+	mat4 View;
+	mat4 Perspective;
+	vec3 viewPosition;
+};
+
+// NR_POINT_LIGHTS and NR_LANTERNS are defined by the program
+struct DirectionalLight {
+    vec3 direction;
+    vec3 rgbIntensity;
+};
+struct LightSource {
+    vec3 position;
+    vec3 rgbIntensity;
+    vec3 attenuationVals;
+};
+layout(std140) uniform Lights {
+    DirectionalLight directionalLight;
+    vec3 dirLightPos;
+    int numPointLights;
+    mat4 dirLightSpaceMatrix;
+    ivec4 clusterDims;      // tiles in x and y, depth slices in z
+    vec4 clusterDepth;      // near, far, slice scale
+    LightSource pointLights[NR_POINT_LIGHTS];
+};
+
+// define lantern types
+#define LANTERN_NORMAL 0
+#define LANTERN_GRAYSCALE 1
+#define LANTERN_CELSHADING 2
+#define LANTERN_INVERT 3
+
+struct Lantern {
+    vec3 position;
+    float radius;
+    int lanternType;
+};
+layout(std140) uniform Lanterns {
+    int numLanterns;
+    Lantern lanterns[NR_LANTERNS];
+};
+
+// CLUSTERS, see LightClusters.hpp
+uniform usamplerBuffer clusterGrid;
+uniform usamplerBuffer clusterIndices;
+
+// returns the index offset, number of point lights and number of lanterns
+// of the cluster the fragment is in
+uvec3 getCluster(vec3 fragPosition) {
+    vec4 viewSpacePos = View * vec4(fragPosition, 1.0);
+    vec4 clipPos = Perspective * viewSpacePos;
+    vec2 ndc = clipPos.xy / clipPos.w;
+    float depth = max(-viewSpacePos.z, clusterDepth.x);
+
+    int x = clamp(int((ndc.x*0.5 + 0.5) * clusterDims.x), 0, clusterDims.x - 1);
+    int y = clamp(int((ndc.y*0.5 + 0.5) * clusterDims.y), 0, clusterDims.y - 1);
+    int z = clamp(int(log(depth / clusterDepth.x) * clusterDepth.z), 0, clusterDims.z - 1);
+    uvec2 cell = texelFetch(clusterGrid, x + clusterDims.x*(y + clusterDims.y*z)).rg;
+    return uvec3(cell.x, cell.y >> 16u, cell.y & 0xFFFFu);
+}
+
+vec4 invert(vec4 c) {
+    return vec4(vec3(1)-vec3(c), c.a);
+}
+
+vec4 grayscale(vec4 c) {
+    float gray = 0.299 * c.r + 0.587 * c.g + 0.114 * c.b;
+    return vec4(gray, gray, gray, c.a);
+}
+
+vec3 rgb2hsv(vec3 c)
+{
+    vec4 K = vec4(0.0, -1.0 / 3.0, 2.0 / 3.0, -1.0);
+    vec4 p = mix(vec4(c.bg, K.wz), vec4(c.gb, K.xy), step(c.b, c.g));
+    vec4 q = mix(vec4(p.xyw, c.r), vec4(c.r, p.yzx), step(p.x, c.r));
+
+    float d = q.x - min(q.w, q.y);
+    float e = 1.0e-10;
+    return vec3(abs(q.z + (q.w - q.y) / (6.0 * d + e)), d / (q.x + e), q.x);
+}
+
+vec3 hsv2rgb(vec3 c)
+{
+    vec4 K = vec4(1.0, 2.0 / 3.0, 1.0 / 3.0, 3.0);
+    vec3 p = abs(fract(c.xxx + K.xyz) * 6.0 - K.www);
+    return c.z * mix(K.xxx, clamp(p - K.xxx, 0.0, 1.0), c.y);
+}
+
+vec4 celShading(vec4 c) {
+    vec3 hsv = rgb2hsv(vec3(c));
+    // the ranges are [0, 0.5] and [0.5, 1]
+    if (hsv[2] < 0.5) { hsv[2] = 0.25; }
+    else { hsv[2] = 0.75; }
+    return vec4(hsv2rgb(hsv), c.a); 
+}
+
+void main() {
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    // nothing was drawn here, leave the sky
+    if (texelFetch(gNormal, pixel, 0).w == 0) { discard; }
+
+    vec3 fragPos = texelFetch(gPosition, pixel, 0).xyz;
+    vec4 phongColour = texelFetch(litColour, pixel, 0);
+    fragColour = phongColour;
+
+    // only the lanterns that reach this cluster, still in order
+    uvec3 cluster = getCluster(fragPos);
+    for (uint j=0u; j<cluster.z; j++) {
+        int i = int(texelFetch(clusterIndices, int(cluster.x + cluster.y + j)).r);
+        vec3 delta = lanterns[i].position - fragPos;
+        float squareDis = dot(delta, delta);
+        float rad = lanterns[i].radius;
+        // if in the radius, apply the filter
+        if (squareDis <= rad*rad) {
+            switch (lanterns[i].lanternType) {
+                case LANTERN_GRAYSCALE:
+                    fragColour = grayscale(phongColour);
+                    break;
+                case LANTERN_INVERT:
+                    fragColour = invert(phongColour);
+                    break;
+                case LANTERN_CELSHADING:
+                    // the lighting pass already has the colour without specular
+                    fragColour = celShading(texelFetch(diffuseColour, pixel, 0));
+                    fragColour[3] = 1;
+                    break;
+            }
+        }
+        // if near a lantern that is activated and not normal,
+        // then blend it with some white
+        float squareDiff = abs(rad*rad-squareDis);
+        if (squareDiff < 10 && rad > 0.01) {
+            float blendFactor = 1/(1+30*squareDiff*squareDiff);
+            fragColour.rgb += (1-fragColour.rgb)*blendFactor;
+        }
+    }
+}
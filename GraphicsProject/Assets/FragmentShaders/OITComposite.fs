@@ -0,0 +1,22 @@
+// blends the weighted blended transparency targets over the opaque scene,
+// see TransparencyPass.hpp
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D accum;        // rgb: weighted colour, a: revealage
+uniform sampler2D weights;      // r: sum of the weights
+
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    vec4 a = texelFetch(accum, pixel, 0);
+    float revealage = a.a;
+    // nothing translucent covers this pixel
+    if (revealage >= 1.0) { discard; }
+
+    float weight = texelFetch(weights, pixel, 0).r;
+    vec3 averageColour = a.rgb / max(weight, 1e-5);
+    FragColor = vec4(averageColour, 1.0 - revealage);
+}
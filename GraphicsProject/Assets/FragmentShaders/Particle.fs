@@ -1,9 +1,21 @@
 #version 330 core
-out vec4 FragColor;
+layout(location = 0) out vec4 FragColor;
+// only bound during the weighted blended transparency pass, see TransparencyPass.hpp
+layout(location = 1) out vec4 oitWeight;
   
 in vec4 fColor;
 
+uniform int oitPass;
+
 void main()
 {
+    if (oitPass != 0) {
+        // same weight as Phong.fs
+        float a = fColor.a;
+        float w = clamp(pow(min(1.0, a * 10.0) + 0.01, 3.0) * 1e8 * pow(1.0 - gl_FragCoord.z * 0.9, 3.0), 1e-2, 3e3);
+        FragColor = vec4(fColor.rgb * a * w, a);
+        oitWeight = vec4(a * w);
+        return;
+    }
     FragColor = fColor;
 }
\ No newline at end of file
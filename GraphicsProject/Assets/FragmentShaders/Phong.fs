@@ -7,27 +7,41 @@ in VsOutFsIn {
     vec4 fragPosDirLightSpace; 
 } fs_in;
 
-out vec4 fragColour;
+layout(location = 0) out vec4 fragColour;
+// only bound during the weighted blended transparency pass, see TransparencyPass.hpp
+layout(location = 1) out vec4 oitWeight;
+uniform int oitPass;
 
 // LIGHTS AND LANTERNS ------------------------------------
+// the blocks are shared by every pass, must match SceneUniforms.hpp
+layout(std140) uniform Camera {
+	mat4 View;
+	mat4 Perspective;
+	vec3 viewPosition;
+};
+
 uniform int shadowsEnabled;
+uniform sampler2D shadowMap;
+
+// NR_POINT_LIGHTS and NR_LANTERNS are defined by the program
 struct DirectionalLight {
     vec3 direction;
     vec3 rgbIntensity;
 };
-uniform DirectionalLight directionalLight;
-uniform vec3 dirLightPos;
-uniform sampler2D shadowMap;
-
-// for now, we cap number of lights to be 10
-#define NR_POINT_LIGHTS 10
 struct LightSource {
     vec3 position;
     vec3 rgbIntensity;
     vec3 attenuationVals;
 };
-uniform LightSource pointLights[NR_POINT_LIGHTS];
-uniform int numPointLights;
+layout(std140) uniform Lights {
+    DirectionalLight directionalLight;
+    vec3 dirLightPos;
+    int numPointLights;
+    mat4 dirLightSpaceMatrix;
+    ivec4 clusterDims;      // tiles in x and y, depth slices in z
+    vec4 clusterDepth;      // near, far, slice scale
+    LightSource pointLights[NR_POINT_LIGHTS];
+};
 
 // Ambient light intensity for each RGB component.
 uniform vec3 ambientIntensity;
@@ -38,15 +52,21 @@ uniform vec3 ambientIntensity;
 #define LANTERN_CELSHADING 2
 #define LANTERN_INVERT 3
 
-// for now, we cap number of lanterns to be 10
-#define NR_LANTERNS 10
 struct Lantern {
     vec3 position;
     float radius;
     int lanternType;
 };
-uniform Lantern lanterns[NR_LANTERNS];
-uniform int numLanterns;
+layout(std140) uniform Lanterns {
+    int numLanterns;
+    Lantern lanterns[NR_LANTERNS];
+};
+
+// CLUSTERS, see LightClusters.hpp
+// per cluster offset into the index list, and the point light and lantern counts packed
+uniform usamplerBuffer clusterGrid;
+// each cluster's point light indices, followed by its lantern indices
+uniform usamplerBuffer clusterIndices;
 
 // TEXTURES AND MATERIALS 
 #define MATERIAL_PLAIN 0
@@ -60,9 +80,6 @@ struct Material {
 uniform Material material;
 uniform sampler2D colourTexture;
 
-// view Position
-uniform vec3 viewPosition;
-
 vec3 phongModelperPointLight(
     vec3 fragPosition, 
     vec3 fragNormal,
@@ -174,13 +191,29 @@ vec3 phongModelforDirectionalLight(
     return directionalLight.rgbIntensity * (diffuse+specular) * (1-shadow);
 }
 
+// returns the index offset, number of point lights and number of lanterns
+// of the cluster the fragment is in
+uvec3 getCluster(vec3 fragPosition) {
+    vec4 viewSpacePos = View * vec4(fragPosition, 1.0);
+    vec4 clipPos = Perspective * viewSpacePos;
+    vec2 ndc = clipPos.xy / clipPos.w;
+    float depth = max(-viewSpacePos.z, clusterDepth.x);
+
+    int x = clamp(int((ndc.x*0.5 + 0.5) * clusterDims.x), 0, clusterDims.x - 1);
+    int y = clamp(int((ndc.y*0.5 + 0.5) * clusterDims.y), 0, clusterDims.y - 1);
+    int z = clamp(int(log(depth / clusterDepth.x) * clusterDepth.z), 0, clusterDims.z - 1);
+    uvec2 cell = texelFetch(clusterGrid, x + clusterDims.x*(y + clusterDims.y*z)).rg;
+    return uvec3(cell.x, cell.y >> 16u, cell.y & 0xFFFFu);
+}
+
 vec4 phongModel(
     vec3 fragPosition, 
     vec3 fragNormal,
     vec4 fragPosDirLightSpace,
 	vec2 fragTexCoords,
     vec3 viewDir,
-    bool includeSpecular
+    bool includeSpecular,
+    uvec3 cluster
 ) {
     vec3 totalColour = ambientIntensity;
 
@@ -206,10 +239,11 @@ vec4 phongModel(
     totalColour += phongModelforDirectionalLight(
         fragPosition, fragNormal, fragPosDirLightSpace, viewDir, kd, ks
     );
-	// all the point lights
-    for (int i=0; i<numPointLights; i++) {
+	// only the point lights that reach this cluster
+    for (uint i=0u; i<cluster.y; i++) {
+        int lightIndex = int(texelFetch(clusterIndices, int(cluster.x + i)).r);
         totalColour += phongModelperPointLight(
-            fragPosition, fragNormal, pointLights[i], viewDir, kd, ks
+            fragPosition, fragNormal, pointLights[lightIndex], viewDir, kd, ks
         );
     } 
     return vec4(totalColour, transparency);
@@ -251,19 +285,30 @@ vec4 celShading(vec4 c) {
     return vec4(hsv2rgb(hsv), c.a); 
 }
 
+// the weight favours opaque and near fragments, so the closest translucent surface dominates
+void writeWeighted(vec4 colour) {
+    float a = colour.a;
+    float w = clamp(pow(min(1.0, a * 10.0) + 0.01, 3.0) * 1e8 * pow(1.0 - gl_FragCoord.z * 0.9, 3.0), 1e-2, 3e3);
+    fragColour = vec4(colour.rgb * a * w, a);
+    oitWeight = vec4(a * w);
+}
+
 void main() {
     vec3 viewDir = normalize(viewPosition - fs_in.fragPos);
+    uvec3 cluster = getCluster(fs_in.fragPos);
 	// by default, the fragment will be phong shaded
     vec4 phongColour = phongModel(
         fs_in.fragPos,
         fs_in.normal, 
         fs_in.fragPosDirLightSpace,
 		fs_in.texCoords,
-        viewDir, true
+        viewDir, true, cluster
     );
     fragColour = phongColour;
 
-    for (int i=0; i<numLanterns; i++) {
+    // only the lanterns that reach this cluster, still in order
+    for (uint j=0u; j<cluster.z; j++) {
+        int i = int(texelFetch(clusterIndices, int(cluster.x + cluster.y + j)).r);
         // distance check
         vec3 lpos = lanterns[i].position;
         float rad = lanterns[i].radius;
@@ -287,7 +332,7 @@ void main() {
                         fs_in.normal, 
                         fs_in.fragPosDirLightSpace, 
 						fs_in.texCoords,
-                        viewDir, false
+                        viewDir, false, cluster
                     ));
 					//translucent objects no longer see through in cel shading
 					fragColour[3] = 1;
@@ -304,4 +349,6 @@ void main() {
             fragColour.b += (1-fragColour.b)*blendFactor;
         }
     }
+
+    if (oitPass != 0) { writeWeighted(fragColour); }
 }
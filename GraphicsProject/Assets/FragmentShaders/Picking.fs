@@ -1,8 +1,8 @@
 #version 330
 // INPUTS/OUTPUTS -----------------------------------------
 out vec4 fragColour;
-uniform vec3 colour;
+flat in vec3 pickColour;
 
 void main() {
-    fragColour = vec4(colour.r, colour.g, colour.b, 1);
+    fragColour = vec4(pickColour.r, pickColour.g, pickColour.b, 1);
 }
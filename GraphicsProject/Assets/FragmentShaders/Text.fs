@@ -1,12 +1,26 @@
 #version 330 core
 in vec2 TexCoords;
+in vec4 textColor;
+in vec4 outlineColor;
 out vec4 color;
 
+// signed distance field of every glyph, 0.5 is the edge of a glyph
 uniform sampler2D text;
-uniform vec4 textColor;
+// how far past the edge the outline goes, in the same units
+uniform float outlineWidth;
 
 void main()
 {    
-    vec4 sampled = vec4(1.0, 1.0, 1.0, texture(text, TexCoords).r);
-    color = textColor * sampled;
+    float dist = texture(text, TexCoords).r;
+    // blend over about a pixel on screen, whatever the scale
+    float w = max(fwidth(dist) * 0.7, 0.001);
+    float fill = smoothstep(0.5 - w, 0.5 + w, dist);
+    float edge = 0.5 - outlineWidth;
+    float line = smoothstep(edge - w, edge + w, dist) * outlineColor.a;
+
+    // the text over its outline
+    float a = mix(line, textColor.a, fill);
+    if (a <= 0.0) { discard; }
+    vec3 rgb = mix(outlineColor.rgb * line, textColor.rgb * textColor.a, fill) / a;
+    color = vec4(rgb, a);
 } 
\ No newline at end of file
@@ -0,0 +1,9 @@
+#version 330 core
+// one triangle covering the screen, made from the vertex id so no buffers are needed.
+// draw with glDrawArrays(GL_TRIANGLES, 0, 3) and any vertex array bound
+
+void main()
+{
+    vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+}
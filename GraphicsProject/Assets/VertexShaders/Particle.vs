@@ -6,16 +6,19 @@ in vec4 offset;     // offset[3] stores size
 
 out vec4 fColor;
 
-uniform mat4 View;
-uniform mat4 Perspective;
-uniform vec3 viewPos;
+// shared by every pass, must match SceneUniforms.hpp
+layout(std140) uniform Camera {
+    mat4 View;
+    mat4 Perspective;
+    vec3 viewPosition;
+};
 
 void main()
 {
     // make sure the particles always face you
     // CR-someday: the particle now always faces you, (normal parallel to viewDir)
     // but other rotation axes are wonky. Should not matter as they are just particles
-    vec3 newZ = normalize(viewPos-vec3(offset));
+    vec3 newZ = normalize(viewPosition-vec3(offset));
     vec3 newX = cross(vec3(0, 1, 1), newZ);
     vec3 newY = cross(newZ, newX);
     mat4 rotation = mat4(
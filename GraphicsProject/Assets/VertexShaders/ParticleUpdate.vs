@@ -0,0 +1,31 @@
+#version 330 core
+// one particle per vertex, must match ParticleGpuState in ParticleFeedback.hpp
+in vec4 offset;         // offset[3] stores size
+in vec4 colour;
+in vec4 velocity;       // velocity[3] stores the remaining life
+in vec4 fadeRate;
+
+// captured with transform feedback, in this order
+out vec4 outOffset;
+out vec4 outColour;
+out vec4 outVelocity;
+out vec4 outFadeRate;
+
+uniform float timeElapsed;
+
+void main()
+{
+    outOffset = offset;
+    outColour = colour;
+    outVelocity = velocity;
+    outFadeRate = fadeRate;
+
+    // same as the CPU path, dead particles are left alone
+    if (velocity[3] > 0) {
+        outOffset.xyz += velocity.xyz * timeElapsed;
+        outColour += fadeRate * timeElapsed;
+        outVelocity[3] -= timeElapsed;
+        // a zero sized quad is never drawn
+        if (outVelocity[3] <= 0) { outOffset[3] = 0; }
+    }
+}
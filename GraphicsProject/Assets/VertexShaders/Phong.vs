@@ -4,12 +4,38 @@
 in vec3 position;
 in vec3 normal;
 in vec2 texCoords;
+// per instance
+in mat4 Model;
 
-// transformation matrices
-uniform mat4 Model;
-uniform mat4 View;
-uniform mat4 Perspective;
-uniform mat4 dirLightSpaceMatrix;
+// must land on exactly the depth the pre-pass wrote with Shadow.vs
+invariant gl_Position;
+
+// shared by every pass, must match SceneUniforms.hpp
+layout(std140) uniform Camera {
+	mat4 View;
+	mat4 Perspective;
+	vec3 viewPosition;
+};
+
+// NR_POINT_LIGHTS is defined by the program
+struct DirectionalLight {
+	vec3 direction;
+	vec3 rgbIntensity;
+};
+struct LightSource {
+	vec3 position;
+	vec3 rgbIntensity;
+	vec3 attenuationVals;
+};
+layout(std140) uniform Lights {
+	DirectionalLight directionalLight;
+	vec3 dirLightPos;
+	int numPointLights;
+	mat4 dirLightSpaceMatrix;
+	ivec4 clusterDims;
+	vec4 clusterDepth;
+	LightSource pointLights[NR_POINT_LIGHTS];
+};
 
 out VsOutFsIn {
 	vec3 fragPos;
@@ -2,11 +2,16 @@
 
 // Model-Space coordinates
 in vec3 position;
+// per instance
+in mat4 Model;
+in vec3 colour;
 
-uniform mat4 Model;
 uniform mat4 View;
 uniform mat4 Perspective;
 
+flat out vec3 pickColour;
+
 void main() {
+	pickColour = colour;
 	gl_Position = Perspective * View * Model * vec4(position, 1.0);
 }
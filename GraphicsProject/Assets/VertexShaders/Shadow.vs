@@ -1,9 +1,14 @@
 #version 330 core
 in vec3 position;
+// per instance
+in mat4 Model;
+
+// also draws the depth pre-pass, which Phong.vs tests against with GL_EQUAL,
+// so both must compute exactly the same position
+invariant gl_Position;
 
 uniform mat4 Perspective;
 uniform mat4 View;
-uniform mat4 Model;
 
 void main()
 {
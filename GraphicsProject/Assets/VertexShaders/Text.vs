@@ -1,12 +1,18 @@
 #version 330 core
 in vec2 pos; 
+in vec2 uv;
+in vec4 colour;
+in vec4 outline;
 out vec2 TexCoords;
+out vec4 textColor;
+out vec4 outlineColor;
 
-uniform mat4 M;
 uniform mat4 P;
 
 void main()
 {
-    gl_Position = P*M*vec4(pos, 0.0, 1.0);
-    TexCoords = vec2(pos.x, 1-pos.y);
+    gl_Position = P*vec4(pos, 0.0, 1.0);
+    TexCoords = uv;
+    textColor = colour;
+    outlineColor = outline;
 } 
\ No newline at end of file
@@ -0,0 +1,161 @@
+// Standalone check that the transform feedback particle backend simulates the
+// same particles as the CPU backend. Both get the same ParticleSpawn stream and
+// their live particles are compared every few ticks.
+// Not part of the game build. It needs no window, the context comes from EGL's
+// surfaceless platform, so it also runs on Mesa's llvmpipe (LIBGL_ALWAYS_SOFTWARE=1).
+// From the GraphicsProject directory:
+//
+//   g++ -std=c++11 -O2 -Iinclude -Isrc bench/ParticleBackendCheck.cpp \
+//       src/Shaders/ParticleShader.cpp src/Shaders/ParticleFeedback.cpp \
+//       src/Shaders/ParticleSort.cpp src/Shaders/ParticleKernels.cpp \
+//       src/Shaders/ShaderProgram.cpp src/Shaders/StreamBuffer.cpp \
+//       src/Application/JobSystem.cpp src/Application/GlErrorCheck.cpp \
+//       src/glad.c -lEGL -lpthread -o ParticleBackendCheck
+//
+// and run it from the same directory, the shaders are read from Assets/
+
+#include "../src/Shaders/ParticleShader.hpp"
+#include "../src/Application/CS488Window.hpp"
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+const unsigned int MAX_PARTICLES = 2000;
+const int NUM_TICKS = 150;
+const int SPAWNS_PER_TICK = 25;
+const int CHECK_EVERY = 10;
+const float TICK_TIME = 1.0f / 60.0f;
+const float MAX_ERROR = 1e-4f;
+
+// the game sets the asset directory up when its window launches
+std::string CS488Window::getAssetFilePath(const char *base) {
+	return std::string("Assets/") + base;
+}
+
+static bool createContext() {
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+		(PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (!getPlatformDisplay) { return false; }
+	EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+	if (!eglInitialize(display, nullptr, nullptr)) { return false; }
+	eglBindAPI(EGL_OPENGL_API);
+
+	// a small pbuffer, draws fail without a complete default framebuffer
+	EGLint configAttribs[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_DEPTH_SIZE, 24,
+		EGL_NONE
+	};
+	EGLConfig config;
+	EGLint numConfigs = 0;
+	if (!eglChooseConfig(display, configAttribs, &config, 1, &numConfigs) || numConfigs == 0) { return false; }
+	EGLint surfaceAttribs[] = { EGL_WIDTH, 64, EGL_HEIGHT, 64, EGL_NONE };
+	EGLSurface surface = eglCreatePbufferSurface(display, config, surfaceAttribs);
+	if (surface == EGL_NO_SURFACE) { return false; }
+
+	EGLint contextAttribs[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 3,
+		EGL_CONTEXT_MINOR_VERSION, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+	if (context == EGL_NO_CONTEXT) { return false; }
+	if (!eglMakeCurrent(display, surface, surface, context)) { return false; }
+	return gladLoadGLLoader((GLADloadproc)eglGetProcAddress) != 0;
+}
+
+static bool particleLess(const ParticleGpuState& a, const ParticleGpuState& b) {
+	for (int i=0; i<4; i++) {
+		if (a.offset[i] != b.offset[i]) { return a.offset[i] < b.offset[i]; }
+	}
+	return a.velocity.w < b.velocity.w;
+}
+
+static float maxDifference(const glm::vec4& a, const glm::vec4& b) {
+	glm::vec4 d = glm::abs(a - b);
+	return std::max(std::max(d.x, d.y), std::max(d.z, d.w));
+}
+
+// returns the largest difference between matching particles, or -1 if the live counts differ
+static float compareParticles(std::vector<ParticleGpuState>& cpu, std::vector<ParticleGpuState>& gpu) {
+	if (cpu.size() != gpu.size()) { return -1; }
+	std::sort(cpu.begin(), cpu.end(), particleLess);
+	std::sort(gpu.begin(), gpu.end(), particleLess);
+	float maxError = 0;
+	for (size_t i=0; i<cpu.size(); i++) {
+		maxError = std::max(maxError, maxDifference(cpu[i].offset, gpu[i].offset));
+		maxError = std::max(maxError, maxDifference(cpu[i].colour, gpu[i].colour));
+		maxError = std::max(maxError, maxDifference(cpu[i].velocity, gpu[i].velocity));
+	}
+	return maxError;
+}
+
+int main() {
+	if (!createContext()) {
+		printf("could not create a GL 3.3 core context through EGL\n");
+		return 1;
+	}
+	printf("GL %s, %s\n", glGetString(GL_VERSION), glGetString(GL_RENDERER));
+
+	JobSystem jobSystem(3);
+	ParticleShader cpu(MAX_PARTICLES, &jobSystem);
+	ParticleShader gpu(MAX_PARTICLES, &jobSystem);
+	cpu.initData();
+	gpu.initData();
+	gpu.setBackend(ParticleBackend::TransformFeedback);
+
+	// short lives so the pool fills up, frees and refills during the run
+	std::mt19937 rng(7);
+	std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+	std::vector<ParticleSpawn> spawns(SPAWNS_PER_TICK);
+	std::vector<ParticleGpuState> cpuLive, gpuLive;
+	int failures = 0;
+
+	for (int tick=0; tick<NUM_TICKS; tick++) {
+		for (ParticleSpawn& s : spawns) {
+			s.pos = glm::vec3(uniform(rng), uniform(rng), uniform(rng));
+			s.colour = glm::vec4(uniform(rng), uniform(rng), uniform(rng), 1);
+			s.fadeRate = glm::vec4(0, 0, 0, -uniform(rng));
+			s.velocity = glm::vec3(uniform(rng), uniform(rng), uniform(rng));
+			s.size = 0.01f + uniform(rng) * 0.05f;
+			s.life = 0.05f + uniform(rng) * 1.5f;
+		}
+		cpu.addParticles(spawns);
+		gpu.addParticles(spawns);
+		cpu.tick(TICK_TIME);
+		gpu.tick(TICK_TIME);
+
+		if (tick % CHECK_EVERY != CHECK_EVERY - 1) { continue; }
+		cpu.getLiveParticles(cpuLive);
+		gpu.getLiveParticles(gpuLive);
+		size_t cpuCount = cpuLive.size();
+		size_t gpuCount = gpuLive.size();
+		float maxError = compareParticles(cpuLive, gpuLive);
+		if (maxError < 0) {
+			printf("tick %3d  live cpu %zu, gpu %zu  MISMATCH\n", tick, cpuCount, gpuCount);
+			failures++;
+		} else {
+			bool ok = maxError <= MAX_ERROR;
+			printf("tick %3d  live %zu  max error %g%s\n", tick, cpuCount, maxError, ok ? "" : "  MISMATCH");
+			if (!ok) { failures++; }
+		}
+	}
+
+	// both backends draw without GL errors
+	gpu.drawScene(glm::vec3(0));
+	cpu.drawScene(glm::vec3(0));
+	if (glGetError() != GL_NO_ERROR) {
+		printf("drawing raised a GL error\n");
+		failures++;
+	}
+
+	printf(failures == 0 ? "backends match\n" : "%d checks failed\n", failures);
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,124 @@
+// Standalone benchmark comparing the old full pool std::sort of particles
+// against the radix and incremental sorts of the live particles' keys.
+// Not part of the game build. From the GraphicsProject directory:
+//
+//   g++ -std=c++11 -O2 -Iinclude -Isrc bench/ParticleSortBenchmark.cpp \
+//       src/Shaders/ParticleSort.cpp -o ParticleSortBenchmark
+
+#include "../src/Shaders/ParticleSort.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtx/norm.hpp>
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+const int NUM_RUNS = 20;
+// the pool is rarely full, this fraction of it is alive
+const float LIVE_FRACTION = 0.75f;
+
+// how particles were stored and sorted before, dead ones included
+struct LegacyParticle {
+	glm::vec3 pos;
+	glm::vec4 col;
+	glm::vec4 fadeRate;
+	glm::vec3 velocity;
+	float size;
+	float life;
+	float camDistance;
+	bool operator<(const LegacyParticle& other) const { return camDistance > other.camDistance; }
+};
+
+static float randf(float lo, float hi) { return lo + (hi - lo) * rand() / (float)RAND_MAX; }
+
+template <typename F>
+static double timeMs(F f) {
+	double total = 0;
+	for (int i = 0; i < NUM_RUNS; i++) {
+		auto start = std::chrono::high_resolution_clock::now();
+		f(i);
+		auto end = std::chrono::high_resolution_clock::now();
+		total += std::chrono::duration<double, std::milli>(end - start).count();
+	}
+	return total / NUM_RUNS;
+}
+
+// fills the keys for the given camera, keeping the order of the entries
+static void computeKeys(std::vector<ParticleSortEntry>& entries, const std::vector<glm::vec3>& positions,
+	std::vector<float>& distances, glm::vec3 viewPos)
+{
+	float nearest = FLT_MAX;
+	float farthest = 0;
+	for (size_t i = 0; i < positions.size(); i++) {
+		distances[i] = glm::length(viewPos - positions[i]);
+		nearest = std::min(nearest, distances[i]);
+		farthest = std::max(farthest, distances[i]);
+	}
+	for (ParticleSortEntry& e : entries) { e.key = quantizeParticleDepth(distances[e.index], nearest, farthest); }
+}
+
+static bool isSorted(const std::vector<ParticleSortEntry>& entries) {
+	for (size_t i = 1; i < entries.size(); i++) {
+		if (entries[i - 1].key > entries[i].key) { return false; }
+	}
+	return true;
+}
+
+static void runBenchmark(int poolSize) {
+	srand(488);
+	int numLive = (int)(poolSize * LIVE_FRACTION);
+
+	std::vector<LegacyParticle> legacy(poolSize);
+	std::vector<glm::vec3> positions(numLive);
+	for (int i = 0; i < poolSize; i++) {
+		legacy[i].pos = glm::vec3(randf(-20, 20), randf(0, 5), randf(-20, 20));
+		legacy[i].life = i < numLive ? 1.0f : 0.0f;
+		if (i < numLive) { positions[i] = legacy[i].pos; }
+	}
+	std::shuffle(legacy.begin(), legacy.end(), std::mt19937(488));
+
+	// the camera drifts a little between frames, like the player walking
+	auto cameraAt = [](int frame) { return glm::vec3(0.05f * frame, 1.2f, 10 - 0.05f * frame); };
+
+	double legacyMs = timeMs([&](int frame) {
+		glm::vec3 viewPos = cameraAt(frame);
+		for (LegacyParticle& p : legacy) {
+			p.camDistance = p.life <= 0 ? -1 : glm::length2(viewPos - p.pos);
+		}
+		std::sort(legacy.begin(), legacy.end());
+	});
+
+	std::vector<ParticleSortEntry> entries(numLive);
+	std::vector<ParticleSortEntry> scratch;
+	std::vector<float> distances(numLive);
+	for (int i = 0; i < numLive; i++) { entries[i].index = i; }
+	bool allSorted = true;
+
+	double radixMs = timeMs([&](int frame) {
+		computeKeys(entries, positions, distances, cameraAt(frame));
+		radixSortParticles(entries, scratch);
+	});
+	allSorted = allSorted && isSorted(entries);
+
+	// starts from the previous frame's order, as the particle shader keeps it
+	double incrementalMs = timeMs([&](int frame) {
+		computeKeys(entries, positions, distances, cameraAt(NUM_RUNS + frame));
+		insertionSortParticles(entries);
+	});
+	allSorted = allSorted && isSorted(entries);
+
+	printf("%8d pool, %8d live   std::sort: %9.3f ms   radix: %8.3f ms   incremental: %8.3f ms   %s\n",
+		poolSize, numLive, legacyMs, radixMs, incrementalMs, allSorted ? "ok" : "NOT SORTED");
+}
+
+int main() {
+	printf("average of %d frames\n", NUM_RUNS);
+	runBenchmark(10000);
+	runBenchmark(100000);
+	runBenchmark(1000000);
+	return 0;
+}
@@ -0,0 +1,113 @@
+// Standalone benchmark comparing a full world transform pass over the
+// pointer linked SceneNode tree, with its cached world matrices, against the
+// flattened SceneStore.
+// Not part of the game build. From the GraphicsProject directory:
+//
+//   g++ -std=c++11 -O2 -Iinclude -Isrc bench/SceneStoreBenchmark.cpp \
+//       src/Objects/SceneNode.cpp src/Objects/GeometryNode.cpp src/Objects/SceneStore.cpp \
+//       src/Objects/NodeRegistry.cpp src/Application/AABB.cpp src/Application/MathUtils.cpp \
+//       -o SceneStoreBenchmark
+
+#include "../src/Objects/SceneStore.hpp"
+
+#include <glm/gtx/transform.hpp>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+const int NUM_NODES = 100000;
+const int NUM_RUNS = 50;
+
+// builds a random tree where a third of the nodes are geometry
+static SceneNode* buildTree(std::vector<SceneNode*>& all) {
+	srand(488);
+	SceneNode* root = new SceneNode("root");
+	all.push_back(root);
+	for (int i = 1; i < NUM_NODES; i++) {
+		SceneNode* node;
+		if (i % 3 == 0) { node = new GeometryNode("cube", "geometry", AABB(-1, 1, -1, 1, -1, 1)); }
+		else { node = new SceneNode("node"); }
+		node->translate(glm::vec3(rand() % 10, rand() % 10, rand() % 10));
+		// bias towards recent nodes so the tree gets some depth
+		int parent = all.size() - 1 - rand() % std::min((int)all.size(), 64);
+		all[parent]->add_child(node);
+		all.push_back(node);
+	}
+	return root;
+}
+
+// the bounds of every subtree, which the store keeps for culling.
+// returns false if the subtree has no geometry
+static bool subtreeBounds(SceneNode* node, AABB& box) {
+	bool found = false;
+	if (node->m_nodeType == NodeType::GeometryNode) {
+		box = static_cast<GeometryNode*>(node)->getTransformedAABB();
+		found = true;
+	}
+	for (SceneNode* child : node->children) {
+		AABB childBox;
+		if (!subtreeBounds(child, childBox)) { continue; }
+		box = found ? box.merge(childBox) : childBox;
+		found = true;
+	}
+	return found;
+}
+
+// how the draw pass walked the tree before the store existed, reading the cached world matrices
+static void recursiveDraw(SceneNode* node, glm::mat4& sink) {
+	if (node->m_nodeType == NodeType::GeometryNode) { sink += node->getWorldTransform(); }
+	for (SceneNode* child : node->children) {
+		recursiveDraw(child, sink);
+	}
+}
+
+template <typename F>
+static double timeMs(F f) {
+	auto start = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < NUM_RUNS; i++) { f(); }
+	auto end = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<double, std::milli>(end - start).count() / NUM_RUNS;
+}
+
+int main() {
+	// two copies of the same tree, the store takes over the world data of the one it flattens
+	std::vector<SceneNode*> all;
+	SceneNode* treeRoot = buildTree(all);
+	all.clear();
+	SceneNode* root = buildTree(all);
+	BatchInfoMap batchInfoMap;
+	glm::mat4 sink(0);
+
+	// both updates dirty the root so that every node is recomputed, then
+	// refresh the world matrices, the geometry bounds and the subtree bounds
+	AABB box;
+	double treeMs = timeMs([&]() {
+		treeRoot->translate(glm::vec3(0));
+		treeRoot->updateGlobalPos(glm::mat4(1), false);
+		subtreeBounds(treeRoot, box);
+	});
+
+	SceneStore store;
+	store.build(root, batchInfoMap);
+	double storeMs = timeMs([&]() {
+		root->translate(glm::vec3(0));
+		store.update();
+	});
+
+	// both read the cached world matrix of every geometry node
+	double drawTreeMs = timeMs([&]() { recursiveDraw(treeRoot, sink); });
+	double drawStoreMs = timeMs([&]() {
+		for (int i : store.geometryIndices) { sink += store.worldTrans[i]; }
+	});
+
+	printf("%d nodes, average of %d runs\n", NUM_NODES, NUM_RUNS);
+	printf("full update   pointer tree: %8.3f ms   store: %8.3f ms\n", treeMs, storeMs);
+	printf("draw walk     pointer tree: %8.3f ms   store: %8.3f ms\n", drawTreeMs, drawStoreMs);
+	printf("(checksum %f %f)\n", sink[0][0], box.maxX);
+
+	store.build(nullptr, batchInfoMap);
+	delete root;
+	delete treeRoot;
+	return 0;
+}
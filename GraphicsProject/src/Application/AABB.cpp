@@ -1,5 +1,6 @@
 #include "AABB.hpp"
 #include <iostream>
+#include <algorithm>
 
 AABB::AABB(float x, float X, float y, float Y, float z, float Z):
 	minX(x), maxX(X), minY(y), maxY(Y), minZ(z), maxZ(Z) {}
@@ -36,15 +37,54 @@ AABB AABB::transform(glm::mat4 m) {
 	);
 }
 
-bool AABB::intersect(const AABB& other) {
+bool AABB::intersect(const AABB& other) const {
 	return (minX <= other.maxX && maxX >= other.minX) &&
 		(minY <= other.maxY && maxY >= other.minY) &&
 		(minZ <= other.maxZ && maxZ >= other.minZ);
 }
 
+AABB AABB::merge(const AABB& other) const {
+	return AABB(
+		std::min(minX, other.minX), std::max(maxX, other.maxX),
+		std::min(minY, other.minY), std::max(maxY, other.maxY),
+		std::min(minZ, other.minZ), std::max(maxZ, other.maxZ)
+	);
+}
+
+glm::vec3 AABB::centroid() const {
+	return glm::vec3(minX + maxX, minY + maxY, minZ + maxZ) * 0.5f;
+}
+
+float AABB::surfaceArea() const {
+	float dx = maxX - minX;
+	float dy = maxY - minY;
+	float dz = maxZ - minZ;
+	return 2.0f * (dx*dy + dy*dz + dz*dx);
+}
+
+bool AABB::operator==(const AABB& other) const {
+	return minX == other.minX && maxX == other.maxX &&
+		minY == other.minY && maxY == other.maxY &&
+		minZ == other.minZ && maxZ == other.maxZ;
+}
+
+bool AABB::operator!=(const AABB& other) const { return !(*this == other); }
+
 void AABB::print() {
 	std::cout <<
 		"x[" << minX << ", " << maxX << "]," <<
 		"y[" << minY << ", " << maxY << "]," <<
 		"z[" << minZ << ", " << maxZ << "],";
-}
\ No newline at end of file
+}
+
+bool AABB::intersectRay(const glm::vec3& origin, const glm::vec3& invDir, float maxT, float& tNear) const {
+	glm::vec3 t0 = (glm::vec3(minX, minY, minZ) - origin) * invDir;
+	glm::vec3 t1 = (glm::vec3(maxX, maxY, maxZ) - origin) * invDir;
+	glm::vec3 tMin = glm::min(t0, t1);
+	glm::vec3 tMax = glm::max(t0, t1);
+	float enter = std::max(std::max(tMin.x, tMin.y), std::max(tMin.z, 0.0f));
+	float exit = std::min(std::min(tMax.x, tMax.y), std::min(tMax.z, maxT));
+	if (enter > exit) { return false; }
+	tNear = enter;
+	return true;
+}
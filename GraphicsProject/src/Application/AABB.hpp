@@ -9,7 +9,18 @@ public:
 	AABB(float x, float X, float y, float Y, float z, float Z);
 
 	// returns true iff intersection
-	bool intersect(const AABB& other);
+	bool intersect(const AABB& other) const;
 	AABB transform(glm::mat4 m);
 	void print();
-};
\ No newline at end of file
+
+	// helpers for building bounding volume hierarchies
+	AABB merge(const AABB& other) const;		// smallest box containing both
+	glm::vec3 centroid() const;
+	float surfaceArea() const;
+	bool operator==(const AABB& other) const;
+	bool operator!=(const AABB& other) const;
+
+	// slab test against the ray origin + t*dir, where invDir is 1/dir per component.
+	// returns true iff the ray hits within [0, maxT], with tNear set to the entry point
+	bool intersectRay(const glm::vec3& origin, const glm::vec3& invDir, float maxT, float& tNear) const;
+};
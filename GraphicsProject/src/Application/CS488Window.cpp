@@ -354,32 +354,41 @@ void CS488Window::run (
         glfwSwapInterval(1);
 
 		// Call client-defined startup code.
+		m_profiler.initData();
         init();
 
 		double prevT = glfwGetTime();
         while (!glfwWindowShouldClose(m_window)) {
 			double t = glfwGetTime();
 			float elapsedTime = t-prevT;
-
-			// CR-someday: add framrate to the HUD or something
-			// std::cout << 1/elapsedTime << std::endl;
+			m_profiler.beginFrame();
 
             glfwPollEvents();
 
 			// TODO: maybe play with framerate?
-			appLogic(elapsedTime);
-			guiLogic();
+			{
+				ProfileScope scope(m_profiler, "appLogic");
+				appLogic(elapsedTime);
+				guiLogic();
+			}
 
 			// Ask the derived class to do the actual OpenGL drawing.
-			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-			draw();
+			{
+				ProfileScope scope(m_profiler, "draw");
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				draw();
+			}
 
 			// In case of a window resize, get new framebuffer dimensions.
 			glfwGetFramebufferSize(m_window, &m_framebufferWidth,
 					&m_framebufferHeight);
 
 			// Finally, blast everything to the screen.
-			glfwSwapBuffers(m_window);
+			{
+				ProfileScope scope(m_profiler, "swap");
+				glfwSwapBuffers(m_window);
+			}
+			m_profiler.endFrame();
 			prevT = t;
         }
 		
@@ -391,6 +400,7 @@ void CS488Window::run (
     }
 
     cleanup();
+	m_profiler.cleanup();
     glfwDestroyWindow(m_window);
 }
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../OpenGLImport.hpp"
+#include "Profiler.hpp"
 #include <string>
 #include <memory>
 
@@ -53,6 +54,7 @@ protected:
 	int m_framebufferHeight;
 	bool m_paused;
 	bool m_fullScreen;
+	Profiler m_profiler;			// times every frame, derived classes add their own scopes
 
 private:
 	static std::shared_ptr<CS488Window> m_instance;
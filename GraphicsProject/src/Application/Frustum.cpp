@@ -0,0 +1,42 @@
+#include "Frustum.hpp"
+
+Frustum::Frustum() {
+	// contains everything
+	for (int i = 0; i < 6; i++) { planes[i] = glm::vec4(0, 0, 0, 1); }
+}
+
+Frustum::Frustum(const glm::mat4& viewProj) {
+	// the planes come straight out of the rows of the matrix (Gribb and Hartmann)
+	glm::vec4 w = glm::vec4(viewProj[0][3], viewProj[1][3], viewProj[2][3], viewProj[3][3]);
+	for (int i = 0; i < 3; i++) {
+		glm::vec4 row = glm::vec4(viewProj[0][i], viewProj[1][i], viewProj[2][i], viewProj[3][i]);
+		planes[2*i] = w + row;
+		planes[2*i + 1] = w - row;
+	}
+	for (int i = 0; i < 6; i++) {
+		planes[i] /= glm::length(glm::vec3(planes[i]));
+	}
+}
+
+bool Frustum::intersectSphere(glm::vec3 center, float radius) const {
+	glm::vec4 c = glm::vec4(center, 1);
+	for (int i = 0; i < 6; i++) {
+		if (glm::dot(planes[i], c) < -radius) { return false; }
+	}
+	return true;
+}
+
+FrustumTest Frustum::testAABB(const AABB& box) const {
+	FrustumTest result = FrustumTest::Inside;
+	for (int i = 0; i < 6; i++) {
+		const glm::vec4& p = planes[i];
+		// the corners furthest along and furthest against the plane normal
+		glm::vec3 furthest = glm::vec3(p.x > 0 ? box.maxX : box.minX, p.y > 0 ? box.maxY : box.minY,
+			p.z > 0 ? box.maxZ : box.minZ);
+		glm::vec3 nearest = glm::vec3(p.x > 0 ? box.minX : box.maxX, p.y > 0 ? box.minY : box.maxY,
+			p.z > 0 ? box.minZ : box.maxZ);
+		if (glm::dot(glm::vec3(p), furthest) + p.w < 0) { return FrustumTest::Outside; }
+		if (glm::dot(glm::vec3(p), nearest) + p.w < 0) { result = FrustumTest::Intersecting; }
+	}
+	return result;
+}
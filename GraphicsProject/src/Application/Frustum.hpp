@@ -0,0 +1,25 @@
+#pragma once
+
+#include "AABB.hpp"
+#include <glm/glm.hpp>
+
+enum class FrustumTest {
+	Outside,
+	Intersecting,
+	Inside
+};
+
+// The six planes of a view projection matrix, facing inwards.
+// Works for perspective and orthographic projections alike
+class Frustum {
+	glm::vec4 planes[6];			// normalized, so a dot product is a distance
+
+	public:
+		Frustum();
+		Frustum(const glm::mat4& viewProj);
+
+		// true if the sphere is at least partly inside
+		bool intersectSphere(glm::vec3 center, float radius) const;
+		// Inside means the whole box is in, so anything within it needs no test
+		FrustumTest testAABB(const AABB& box) const;
+};
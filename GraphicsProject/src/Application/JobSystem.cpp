@@ -0,0 +1,91 @@
+#include "JobSystem.hpp"
+
+#include <algorithm>
+
+JobSystem::JobSystem(unsigned int numWorkers) : stopping(false), current({ nullptr, 0, 1, 0 }),
+	chunksRemaining(0), activeWorkers(0), generation(0), nextChunk(0)
+{
+	if (numWorkers == 0) {
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		numWorkers = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+	}
+	for (unsigned int i = 0; i < numWorkers; i++) {
+		workers.push_back(std::thread(&JobSystem::workerLoop, this));
+	}
+}
+
+JobSystem::~JobSystem() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	workReady.notify_all();
+	for (std::thread& worker : workers) { worker.join(); }
+}
+
+void JobSystem::workerLoop() {
+	unsigned long long seen = 0;
+	while (true) {
+		JobInfo info;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			workReady.wait(lock, [&]() { return stopping || generation != seen; });
+			if (stopping) { return; }
+			seen = generation;
+			// woke after the call had already returned
+			if (current.job == nullptr) { continue; }
+			info = current;
+			activeWorkers++;
+		}
+		unsigned int done = runChunks(info);
+
+		// the call waits for every active worker, so it can not return while this one is running
+		std::lock_guard<std::mutex> lock(mutex);
+		chunksRemaining -= done;
+		activeWorkers--;
+		if (chunksRemaining == 0 && activeWorkers == 0) { workDone.notify_all(); }
+	}
+}
+
+unsigned int JobSystem::runChunks(const JobInfo& info) {
+	unsigned int done = 0;
+	while (true) {
+		// a worker waking late just finds no chunks left
+		unsigned int chunk = nextChunk.fetch_add(1);
+		if (chunk >= info.numChunks) { break; }
+		unsigned int begin = chunk * info.chunkSize;
+		(*info.job)(begin, std::min(begin + info.chunkSize, info.count));
+		done++;
+	}
+	return done;
+}
+
+void JobSystem::parallelFor(unsigned int count, unsigned int chunkSize, const ChunkJob& f) {
+	if (count == 0) { return; }
+	chunkSize = std::max(1u, chunkSize);
+	unsigned int chunks = (count + chunkSize - 1) / chunkSize;
+	// not worth waking anyone
+	if (workers.empty() || chunks == 1) {
+		f(0, count);
+		return;
+	}
+
+	JobInfo info = { &f, count, chunkSize, chunks };
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		current = info;
+		chunksRemaining = chunks;
+		nextChunk = 0;
+		generation++;
+	}
+	workReady.notify_all();
+	unsigned int done = runChunks(info);
+
+	// the workers still hold f until they have all left
+	std::unique_lock<std::mutex> lock(mutex);
+	chunksRemaining -= done;
+	workDone.wait(lock, [this]() { return chunksRemaining == 0 && activeWorkers == 0; });
+	current.job = nullptr;
+}
+
+unsigned int JobSystem::getNumThreads() { return workers.size() + 1; }
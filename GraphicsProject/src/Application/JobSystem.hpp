@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// runs job(begin, end) over one chunk of a range
+typedef std::function<void(unsigned int, unsigned int)> ChunkJob;
+
+// A fixed pool of worker threads for splitting loops into chunks.
+// parallelFor blocks until every chunk is done, and the calling thread runs chunks too
+class JobSystem {
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable workReady;
+	std::condition_variable workDone;
+	bool stopping;
+
+	// one parallelFor, workers copy it under the mutex so a later call can not change it under them
+	struct JobInfo {
+		const ChunkJob* job;			// nullptr once the call has returned
+		unsigned int count;
+		unsigned int chunkSize;
+		unsigned int numChunks;
+	};
+
+	// the current parallelFor, set under the mutex
+	JobInfo current;
+	unsigned int chunksRemaining;
+	unsigned int activeWorkers;			// workers that took the current job and have not finished it
+	unsigned long long generation;		// bumped for every parallelFor, wakes the workers
+	std::atomic<unsigned int> nextChunk;
+
+	void workerLoop();
+	// returns the number of chunks it ran
+	unsigned int runChunks(const JobInfo& info);
+
+	public:
+		// numWorkers of 0 uses one less than the number of hardware threads
+		JobSystem(unsigned int numWorkers = 0);
+		~JobSystem();
+
+		void parallelFor(unsigned int count, unsigned int chunkSize, const ChunkJob& f);
+		// workers plus the calling thread
+		unsigned int getNumThreads();
+};
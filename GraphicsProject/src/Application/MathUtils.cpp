@@ -1,10 +1,63 @@
 #include "MathUtils.hpp"
 #include <cmath>
 
+// xorshift64* state, never 0
+static thread_local unsigned long long randomState = 0x9E3779B97F4A7C15ULL;
+
+// splitmix64 finalizer, spreads nearby seeds far apart
+static unsigned long long scramble(unsigned long long x) {
+	x += 0x9E3779B97F4A7C15ULL;
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+	return x ^ (x >> 31);
+}
+
+void seedRandom(unsigned long long seed) {
+	randomState = scramble(seed);
+	if (randomState == 0) { randomState = 1; }
+}
+
+unsigned long long mixSeed(unsigned long long seed, unsigned long long value) {
+	return scramble(seed ^ scramble(value));
+}
+
+static unsigned int nextRandom() {
+	randomState ^= randomState >> 12;
+	randomState ^= randomState << 25;
+	randomState ^= randomState >> 27;
+	return (unsigned int)((randomState * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
 float randRange(float lo, float hi) {
-	return ((hi - lo)*(float)rand() / RAND_MAX) + lo;
+	// top 24 bits, so the result is below 1
+	float t = (nextRandom() >> 8) * (1.0f / 16777216.0f);
+	return ((hi - lo)*t) + lo;
 }
 
 int randRangeInt(int lo, int hi) {
 	return floor(randRange(lo, hi));
-}
\ No newline at end of file
+}
+
+bool intersectRayTriangle(const glm::vec3& origin, const glm::vec3& dir,
+	const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2, float& t) {
+	const float EPSILON = 1e-7f;
+	glm::vec3 e1 = v1 - v0;
+	glm::vec3 e2 = v2 - v0;
+	glm::vec3 p = glm::cross(dir, e2);
+	float det = glm::dot(e1, p);
+	// ray is parallel to the triangle. back faces are not culled
+	if (fabs(det) < EPSILON) { return false; }
+	float invDet = 1.0f / det;
+
+	glm::vec3 s = origin - v0;
+	float u = glm::dot(s, p) * invDet;
+	if (u < 0 || u > 1) { return false; }
+	glm::vec3 q = glm::cross(s, e1);
+	float v = glm::dot(dir, q) * invDet;
+	if (v < 0 || u + v > 1) { return false; }
+
+	float hit = glm::dot(e2, q) * invDet;
+	if (hit <= 0) { return false; }
+	t = hit;
+	return true;
+}
@@ -1,9 +1,21 @@
 #pragma once
 
+#include <glm/glm.hpp>
+
 const double PI = 3.14159265;
 
+// each thread has its own generator, so these are safe to call from jobs.
+// seedRandom makes the sequence on the calling thread repeatable
+void seedRandom(unsigned long long seed);
 float randRange(float lo, float hi);		// rand float in [lo, hi)
 int randRangeInt(int lo, int hi);			// rand int in [lo, hi)
+// combines two values into a new seed, e.g. a base seed and a job index
+unsigned long long mixSeed(unsigned long long seed, unsigned long long value);
+
+// Moller-Trumbore test of the ray origin + t*dir against a triangle.
+// returns true iff it hits with t > 0, with t set to the hit
+bool intersectRayTriangle(const glm::vec3& origin, const glm::vec3& dir,
+	const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2, float& t);
 
 //---------------------------------------------------------------------------------------
 template <typename T>
@@ -0,0 +1,224 @@
+#include "OcclusionCuller.hpp"
+#include "Frustum.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// polygons with less screen area than this, in pixels, are not drawn
+const float MIN_POLYGON_AREA = 1e-4f;
+
+// corners of a box numbered by bits, x is bit 0, y is bit 1 and z is bit 2.
+// each face is listed in order around its edge
+const int BOX_FACES[6][4] = {
+	{ 0, 2, 6, 4 }, { 1, 3, 7, 5 },		// -x, +x
+	{ 0, 1, 5, 4 }, { 2, 3, 7, 6 },		// -y, +y
+	{ 0, 1, 3, 2 }, { 4, 5, 7, 6 }		// -z, +z
+};
+
+OcclusionCuller::OcclusionCuller() : isEnabled(true), viewProj(1), numOccluders(0) {
+	int width = OCCLUSION_WIDTH;
+	int height = OCCLUSION_HEIGHT;
+	while (true) {
+		levels.push_back({ width, height, std::vector<float>(width * height, 1.0f) });
+		if (width == 1 && height == 1) { break; }
+		width = std::max(1, width / 2);
+		height = std::max(1, height / 2);
+	}
+}
+
+void OcclusionCuller::update(const SceneStore& store, const glm::mat4& V, const glm::mat4& P, glm::vec3 viewPos) {
+	viewProj = P * V;
+	results.assign(store.size(), Untested);
+	numOccluders = 0;
+	if (!isEnabled) { return; }
+
+	std::fill(levels[0].depths.begin(), levels[0].depths.end(), 1.0f);
+	Frustum frustum(viewProj);
+	for (int i : store.occluderIndices) {
+		// deleted since the store was built
+		if (store.nodes[i] == nullptr) { continue; }
+		if (frustum.testAABB(store.worldAABBs[i]) == FrustumTest::Outside) { continue; }
+		rasterizeBox(store.baseAABBs[i], store.worldTrans[i], viewPos);
+		numOccluders++;
+	}
+	buildPyramid();
+}
+
+void OcclusionCuller::rasterizeBox(const AABB& box, const glm::mat4& M, glm::vec3 viewPos) {
+	glm::vec3 world[8];
+	glm::vec4 clip[8];
+	glm::vec3 center = glm::vec3(0);
+	for (int k = 0; k < 8; k++) {
+		glm::vec4 local = glm::vec4(k & 1 ? box.maxX : box.minX, k & 2 ? box.maxY : box.minY,
+			k & 4 ? box.maxZ : box.minZ, 1);
+		world[k] = glm::vec3(M * local);
+		clip[k] = viewProj * glm::vec4(world[k], 1);
+		center += world[k] / 8.0f;
+	}
+
+	for (int f = 0; f < 6; f++) {
+		const int* face = BOX_FACES[f];
+		// faces pointing away are hidden by the ones in front of them
+		glm::vec3 faceCenter = (world[face[0]] + world[face[1]] + world[face[2]] + world[face[3]]) / 4.0f;
+		if (glm::dot(faceCenter - viewPos, faceCenter - center) > 0) { continue; }
+
+		glm::vec4 corners[4] = { clip[face[0]], clip[face[1]], clip[face[2]], clip[face[3]] };
+		rasterizePolygon(corners, 4);
+	}
+}
+
+void OcclusionCuller::rasterizePolygon(const glm::vec4* corners, int numCorners) {
+	// clip against the near plane, z >= -w, so every corner can be divided by w
+	clipped.clear();
+	for (int k = 0; k < numCorners; k++) {
+		const glm::vec4& a = corners[k];
+		const glm::vec4& b = corners[(k + 1) % numCorners];
+		float da = a.z + a.w;
+		float db = b.z + b.w;
+		if (da >= 0) { clipped.push_back(a); }
+		if ((da >= 0) != (db >= 0)) { clipped.push_back(a + (b - a) * (da / (da - db))); }
+	}
+	if (clipped.size() < 3) { return; }
+
+	// to pixel coordinates, with NDC depth
+	DepthLevel& level = levels[0];
+	screen.clear();
+	for (const glm::vec4& c : clipped) {
+		screen.push_back(glm::vec3((c.x / c.w * 0.5f + 0.5f) * level.width,
+			(c.y / c.w * 0.5f + 0.5f) * level.height, c.z / c.w));
+	}
+
+	// signed area, so the edges can be made to face inwards whichever way the polygon winds.
+	// the depth plane comes from the widest triangle of the fan, to stay clear of slivers
+	float area = 0;
+	int widest = 1;
+	float widestArea = 0;
+	float minX = screen[0].x, maxX = screen[0].x, minY = screen[0].y, maxY = screen[0].y, maxZ = screen[0].z;
+	for (int k = 1; k < screen.size(); k++) {
+		minX = std::min(minX, screen[k].x);
+		maxX = std::max(maxX, screen[k].x);
+		minY = std::min(minY, screen[k].y);
+		maxY = std::max(maxY, screen[k].y);
+		maxZ = std::max(maxZ, screen[k].z);
+		if (k + 1 < screen.size()) {
+			glm::vec3 d1 = screen[k] - screen[0];
+			glm::vec3 d2 = screen[k + 1] - screen[0];
+			float triangleArea = d1.x * d2.y - d2.x * d1.y;
+			area += triangleArea;
+			if (std::abs(triangleArea) > widestArea) {
+				widestArea = std::abs(triangleArea);
+				widest = k;
+			}
+		}
+	}
+	if (std::abs(area) < MIN_POLYGON_AREA) { return; }
+	float winding = area > 0 ? 1.0f : -1.0f;
+
+	// depth = dzdx*x + dzdy*y + z0, depth is linear in screen space after the divide
+	glm::vec3 d1 = screen[widest] - screen[0];
+	glm::vec3 d2 = screen[widest + 1] - screen[0];
+	float det = d1.x * d2.y - d2.x * d1.y;
+	float dzdx = (d1.z * d2.y - d2.z * d1.y) / det;
+	float dzdy = (d1.x * d2.z - d2.x * d1.z) / det;
+	float z0 = screen[0].z - dzdx * screen[0].x - dzdy * screen[0].y;
+	// the furthest the plane gets from a pixel centre within the pixel
+	float dzPixel = 0.5f * (std::abs(dzdx) + std::abs(dzdy));
+
+	int x0 = std::max(0, (int)std::floor(minX));
+	int x1 = std::min(level.width - 1, (int)std::ceil(maxX));
+	int y0 = std::max(0, (int)std::floor(minY));
+	int y1 = std::min(level.height - 1, (int)std::ceil(maxY));
+	int n = screen.size();
+	for (int y = y0; y <= y1; y++) {
+		float py = y + 0.5f;
+		for (int x = x0; x <= x1; x++) {
+			float px = x + 0.5f;
+			// only pixels completely inside the polygon are covered, so no pixel
+			// claims to be hidden by a polygon that just touches it
+			bool covered = true;
+			for (int k = 0; k < n && covered; k++) {
+				const glm::vec3& a = screen[k];
+				const glm::vec3& b = screen[(k + 1) % n];
+				float ex = -(b.y - a.y) * winding;
+				float ey = (b.x - a.x) * winding;
+				float e = ex * (px - a.x) + ey * (py - a.y);
+				covered = e >= 0.5f * (std::abs(ex) + std::abs(ey));
+			}
+			if (!covered) { continue; }
+
+			float depth = std::min(dzdx * px + dzdy * py + z0 + dzPixel, maxZ);
+			float& stored = level.depths[y * level.width + x];
+			stored = std::min(stored, depth);
+		}
+	}
+}
+
+void OcclusionCuller::buildPyramid() {
+	// each texel keeps the furthest of the four under it
+	for (int l = 1; l < levels.size(); l++) {
+		const DepthLevel& fine = levels[l - 1];
+		DepthLevel& coarse = levels[l];
+		for (int y = 0; y < coarse.height; y++) {
+			int fy0 = std::min(2 * y, fine.height - 1);
+			int fy1 = std::min(2 * y + 1, fine.height - 1);
+			for (int x = 0; x < coarse.width; x++) {
+				int fx0 = std::min(2 * x, fine.width - 1);
+				int fx1 = std::min(2 * x + 1, fine.width - 1);
+				coarse.depths[y * coarse.width + x] = std::max(
+					std::max(fine.depths[fy0 * fine.width + fx0], fine.depths[fy0 * fine.width + fx1]),
+					std::max(fine.depths[fy1 * fine.width + fx0], fine.depths[fy1 * fine.width + fx1]));
+			}
+		}
+	}
+}
+
+bool OcclusionCuller::testAABB(const AABB& box) {
+	const DepthLevel& base = levels[0];
+	float minX = (float)base.width, maxX = 0, minY = (float)base.height, maxY = 0, minZ = 1;
+	for (int k = 0; k < 8; k++) {
+		glm::vec4 c = viewProj * glm::vec4(k & 1 ? box.maxX : box.minX, k & 2 ? box.maxY : box.minY,
+			k & 4 ? box.maxZ : box.minZ, 1);
+		// reaches past the near plane, so it can not be behind anything
+		if (c.w <= 0 || c.z < -c.w) { return false; }
+		float x = (c.x / c.w * 0.5f + 0.5f) * base.width;
+		float y = (c.y / c.w * 0.5f + 0.5f) * base.height;
+		minX = std::min(minX, x);
+		maxX = std::max(maxX, x);
+		minY = std::min(minY, y);
+		maxY = std::max(maxY, y);
+		minZ = std::min(minZ, c.z / c.w);
+	}
+
+	int x0 = std::max(0, (int)std::floor(minX));
+	int x1 = std::min(base.width - 1, (int)std::floor(maxX));
+	int y0 = std::max(0, (int)std::floor(minY));
+	int y1 = std::min(base.height - 1, (int)std::floor(maxY));
+	// off screen, the frustum test deals with these
+	if (x0 > x1 || y0 > y1) { return false; }
+
+	// the finest level where the box covers at most 2x2 texels
+	int l = 0;
+	while (l + 1 < levels.size() && ((x1 >> l) - (x0 >> l) > 1 || (y1 >> l) - (y0 >> l) > 1)) { l++; }
+	const DepthLevel& level = levels[l];
+	float maxDepth = -1;
+	for (int y = std::min(y0 >> l, level.height - 1); y <= std::min(y1 >> l, level.height - 1); y++) {
+		for (int x = std::min(x0 >> l, level.width - 1); x <= std::min(x1 >> l, level.width - 1); x++) {
+			maxDepth = std::max(maxDepth, level.depths[y * level.width + x]);
+		}
+	}
+	return minZ > maxDepth;
+}
+
+bool OcclusionCuller::isOccluded(const SceneStore& store, int i) {
+	if (!isEnabled || numOccluders == 0 || i >= results.size()) { return false; }
+	if (results[i] == Untested) {
+		results[i] = testAABB(store.subtreeAABBs[i]) ? Occluded : Visible;
+	}
+	return results[i] == Occluded;
+}
+
+int OcclusionCuller::getNumOccluders() { return numOccluders; }
+
+bool OcclusionCuller::getIsEnabled() { return isEnabled; }
+
+void OcclusionCuller::setIsEnabled(bool b) { isEnabled = b; }
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "AABB.hpp"
+#include "../Objects/SceneStore.hpp"
+
+#include <glm/glm.hpp>
+#include <vector>
+
+// size of the occluder depth buffer, the finest level of the pyramid
+const int OCCLUSION_WIDTH = 256;
+const int OCCLUSION_HEIGHT = 128;
+
+// Software occlusion culling against the scene's large solid boxes, like walls and crates.
+// Every frame the occluders in view are rasterized on the CPU into a small depth buffer,
+// keeping the furthest depth within each pixel so nothing is hidden by mistake. A max depth
+// pyramid over it lets any box be tested against a couple of texels.
+// Results are cached per store index until the next update, so every pass drawn with the
+// same camera (main and picking) shares them
+class OcclusionCuller {
+	enum Result : unsigned char {
+		Untested,
+		Visible,
+		Occluded
+	};
+
+	// level 0 is the full buffer, each level after it halves the size
+	struct DepthLevel {
+		int width;
+		int height;
+		std::vector<float> depths;		// NDC depth, 1 where nothing was drawn
+	};
+
+	bool isEnabled;
+	glm::mat4 viewProj;
+	std::vector<DepthLevel> levels;
+	std::vector<unsigned char> results;	// per store index
+	int numOccluders;					// drawn in the last update
+
+	// scratch space for rasterizing
+	std::vector<glm::vec4> clipped;
+	std::vector<glm::vec3> screen;
+
+	void rasterizeBox(const AABB& box, const glm::mat4& M, glm::vec3 viewPos);
+	// polygon in clip space, clipped to the near plane before drawing
+	void rasterizePolygon(const glm::vec4* corners, int numCorners);
+	void buildPyramid();
+	bool testAABB(const AABB& box);
+
+	public:
+		OcclusionCuller();
+
+		// draws the occluders in the store seen with this camera, and forgets every cached result.
+		// call after the world transforms are updated, and before any pass uses the results
+		void update(const SceneStore& store, const glm::mat4& V, const glm::mat4& P, glm::vec3 viewPos);
+		// true iff the whole subtree at store index i is hidden behind the occluders
+		bool isOccluded(const SceneStore& store, int i);
+
+		int getNumOccluders();
+		bool getIsEnabled();
+		void setIsEnabled(bool b);
+};
@@ -0,0 +1,215 @@
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+// results are given this many frames to arrive, after that they are dropped
+const int MAX_QUERY_LATENCY = 8;
+// trace lanes, the gpu gets its own so its slices do not overlap the cpu ones
+const int TRACE_CPU_THREAD = 1;
+const int TRACE_GPU_THREAD = 2;
+
+Profiler::Profiler() : epoch(std::chrono::steady_clock::now()), frames(PROFILER_HISTORY),
+	frameNumber(0), isSupported(false), gpuQueryActive(false) {}
+
+void Profiler::initData() {
+	// timer queries are core in 3.3
+	isSupported = GLAD_GL_VERSION_3_3;
+}
+
+void Profiler::cleanup() {
+	for (FrameRecord& frame : frames) { releaseQueries(frame); }
+	if (!freeQueries.empty()) {
+		glDeleteQueries(freeQueries.size(), freeQueries.data());
+	}
+	freeQueries.clear();
+}
+
+Profiler::FrameRecord& Profiler::currentFrame() {
+	return frames[(frameNumber + PROFILER_HISTORY - 1) % PROFILER_HISTORY];
+}
+
+void Profiler::pollQueries(FrameRecord& frame) {
+	// queries finish in order, so stop at the first one that is not ready
+	size_t done = 0;
+	for (; done < frame.pendingQueries.size(); done++) {
+		GpuQuery& pending = frame.pendingQueries[done];
+		GLuint available = 0;
+		glGetQueryObjectuiv(pending.query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available) { break; }
+
+		GLuint64 nanoseconds = 0;
+		glGetQueryObjectui64v(pending.query, GL_QUERY_RESULT, &nanoseconds);
+		frame.events.push_back({ pending.section, pending.issued, nanoseconds * 1e-9, true });
+		freeQueries.push_back(pending.query);
+	}
+	frame.pendingQueries.erase(frame.pendingQueries.begin(), frame.pendingQueries.begin() + done);
+}
+
+void Profiler::releaseQueries(FrameRecord& frame) {
+	for (GpuQuery& pending : frame.pendingQueries) { freeQueries.push_back(pending.query); }
+	frame.pendingQueries.clear();
+}
+
+void Profiler::beginFrame() {
+	// collect results for the frames still waiting on the gpu
+	for (int i = 1; i <= MAX_QUERY_LATENCY && i <= frameNumber && i < PROFILER_HISTORY; i++) {
+		FrameRecord& frame = frames[(frameNumber + PROFILER_HISTORY - i) % PROFILER_HISTORY];
+		if (i == MAX_QUERY_LATENCY) { releaseQueries(frame); }
+		else { pollQueries(frame); }
+	}
+
+	// reuse the oldest frame, its vectors keep their memory
+	frameNumber++;
+	FrameRecord& frame = currentFrame();
+	releaseQueries(frame);
+	frame.events.clear();
+	frame.counters.clear();
+	frame.start = now();
+	frame.duration = 0;
+}
+
+void Profiler::endFrame() {
+	if (frameNumber == 0) { return; }
+	FrameRecord& frame = currentFrame();
+	frame.duration = now() - frame.start;
+}
+
+double Profiler::now() {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+int Profiler::getSectionId(const char* name) {
+	auto found = sectionIds.find(name);
+	if (found != sectionIds.end()) { return found->second; }
+	int id = sectionNames.size();
+	sectionIds[name] = id;
+	sectionNames.push_back(name);
+	return id;
+}
+
+void Profiler::addCpuEvent(int section, double start, double duration) {
+	if (frameNumber == 0) { return; }
+	currentFrame().events.push_back({ section, start, duration, false });
+}
+
+void Profiler::setCounter(const char* name, float value) {
+	if (frameNumber == 0) { return; }
+	auto found = counterIds.find(name);
+	int id;
+	if (found != counterIds.end()) { id = found->second; }
+	else {
+		id = counterNames.size();
+		counterIds[name] = id;
+		counterNames.push_back(name);
+		counterValues.push_back(0);
+	}
+	counterValues[id] = value;
+	currentFrame().counters.push_back({ id, value });
+}
+
+GLuint Profiler::beginGpuQuery(int section) {
+	if (!isSupported || gpuQueryActive || frameNumber == 0) { return 0; }
+	GLuint query;
+	if (freeQueries.empty()) {
+		glGenQueries(1, &query);
+	}
+	else {
+		query = freeQueries.back();
+		freeQueries.pop_back();
+	}
+	glBeginQuery(GL_TIME_ELAPSED, query);
+	gpuQueryActive = true;
+	currentFrame().pendingQueries.push_back({ section, query, now() });
+	return query;
+}
+
+void Profiler::endGpuQuery(GLuint query) {
+	if (query == 0) { return; }
+	glEndQuery(GL_TIME_ELAPSED);
+	gpuQueryActive = false;
+}
+
+float Profiler::getAverage(int section, bool gpu) {
+	double total = 0;
+	int count = 0;
+	// skip the current frame, it is still being recorded
+	for (int i = 1; i < PROFILER_HISTORY && i < frameNumber; i++) {
+		FrameRecord& frame = frames[(frameNumber + PROFILER_HISTORY - 1 - i) % PROFILER_HISTORY];
+		bool found = false;
+		for (ProfileEvent& e : frame.events) {
+			if (e.section == section && e.gpu == gpu) {
+				total += e.duration;
+				found = true;
+			}
+		}
+		if (found) { count++; }
+	}
+	return count == 0 ? 0 : (float)(total / count * 1000);
+}
+
+void Profiler::getFrameTimes(std::vector<float>& times) {
+	times.clear();
+	int count = std::min((unsigned long long)PROFILER_HISTORY - 1, frameNumber > 0 ? frameNumber - 1 : 0);
+	for (int i = count; i >= 1; i--) {
+		FrameRecord& frame = frames[(frameNumber + PROFILER_HISTORY - 1 - i) % PROFILER_HISTORY];
+		times.push_back((float)(frame.duration * 1000));
+	}
+}
+
+const std::vector<std::string>& Profiler::getSectionNames() { return sectionNames; }
+
+const std::vector<std::string>& Profiler::getCounterNames() { return counterNames; }
+
+float Profiler::getCounter(int counter) { return counterValues[counter]; }
+
+bool Profiler::writeChromeTrace(const std::string& path) {
+	std::ofstream file(path, std::ios::trunc);
+	if (!file) { return false; }
+
+	file << std::fixed << std::setprecision(3);
+	file << "{\"traceEvents\":[\n";
+	file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << TRACE_CPU_THREAD
+		<< ",\"args\":{\"name\":\"CPU\"}},\n";
+	file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << TRACE_GPU_THREAD
+		<< ",\"args\":{\"name\":\"GPU\"}}";
+
+	// oldest finished frame first, gpu work runs one thing at a time so each slice
+	// starts when it was sent or when the previous one finished
+	double gpuFree = 0;
+	int count = std::min((unsigned long long)PROFILER_HISTORY - 1, frameNumber > 0 ? frameNumber - 1 : 0);
+	for (int i = count; i >= 1; i--) {
+		FrameRecord& frame = frames[(frameNumber + PROFILER_HISTORY - 1 - i) % PROFILER_HISTORY];
+		file << ",\n{\"name\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":" << TRACE_CPU_THREAD
+			<< ",\"ts\":" << frame.start * 1e6 << ",\"dur\":" << frame.duration * 1e6 << "}";
+		for (ProfileEvent& e : frame.events) {
+			double start = e.start;
+			if (e.gpu) {
+				start = std::max(start, gpuFree);
+				gpuFree = start + e.duration;
+			}
+			file << ",\n{\"name\":\"" << sectionNames[e.section] << "\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+				<< (e.gpu ? TRACE_GPU_THREAD : TRACE_CPU_THREAD)
+				<< ",\"ts\":" << start * 1e6 << ",\"dur\":" << e.duration * 1e6 << "}";
+		}
+		for (ProfileCounter& c : frame.counters) {
+			file << ",\n{\"name\":\"" << counterNames[c.counter] << "\",\"ph\":\"C\",\"pid\":1"
+				<< ",\"ts\":" << frame.start * 1e6 << ",\"args\":{\"value\":" << c.value << "}}";
+		}
+	}
+	file << "\n]}\n";
+	return (bool)file;
+}
+
+ProfileScope::ProfileScope(Profiler& profiler_, const char* name, bool gpu)
+	: profiler(profiler_), section(profiler_.getSectionId(name)), query(0) {
+	if (gpu) { query = profiler.beginGpuQuery(section); }
+	start = profiler.now();
+}
+
+ProfileScope::~ProfileScope() {
+	double end = profiler.now();
+	profiler.endGpuQuery(query);
+	profiler.addCpuEvent(section, start, end - start);
+}
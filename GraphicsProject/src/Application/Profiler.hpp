@@ -0,0 +1,106 @@
+#pragma once
+
+#include "../OpenGLImport.hpp"
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// how many frames of timings are kept, for the overlay and for traces
+const int PROFILER_HISTORY = 120;
+
+// one timed piece of a frame, times are in seconds since the profiler started
+struct ProfileEvent {
+	int section;
+	double start;
+	double duration;
+	bool gpu;
+};
+
+// a value recorded once a frame, like how many objects were drawn
+struct ProfileCounter {
+	int counter;
+	float value;
+};
+
+// Records how long the named parts of each frame take.
+// CPU times come from ProfileScope and GPU times from GL_TIME_ELAPSED queries,
+// which are read back a few frames later so they never stall the pipeline.
+// Everything is kept in a ring of the last PROFILER_HISTORY frames.
+// Scopes should only be opened on the main thread
+class Profiler {
+	struct GpuQuery {
+		int section;
+		GLuint query;
+		double issued;			// when the commands were sent, for laying out the trace
+	};
+
+	struct FrameRecord {
+		double start;
+		double duration;
+		std::vector<ProfileEvent> events;
+		std::vector<ProfileCounter> counters;
+		std::vector<GpuQuery> pendingQueries;
+	};
+
+	std::chrono::steady_clock::time_point epoch;
+	std::vector<FrameRecord> frames;
+	unsigned long long frameNumber;		// frames begun so far, the current one is frameNumber-1
+	bool isSupported;
+
+	// names are string literals, so they are looked up by address
+	std::unordered_map<const char*, int> sectionIds;
+	std::vector<std::string> sectionNames;
+	std::unordered_map<const char*, int> counterIds;
+	std::vector<std::string> counterNames;
+	std::vector<float> counterValues;		// the latest value of each counter
+
+	std::vector<GLuint> freeQueries;
+	bool gpuQueryActive;				// time elapsed queries can not nest
+
+	FrameRecord& currentFrame();
+	// picks up any query results that have arrived, never waits for them
+	void pollQueries(FrameRecord& frame);
+	void releaseQueries(FrameRecord& frame);
+
+	public:
+		Profiler();
+		void initData();
+		// deletes the queries, call while the context is still current
+		void cleanup();
+
+		void beginFrame();
+		void endFrame();
+
+		double now();
+		int getSectionId(const char* name);
+		void addCpuEvent(int section, double start, double duration);
+		// returns 0 if a gpu query is already running
+		GLuint beginGpuQuery(int section);
+		void endGpuQuery(GLuint query);
+
+		void setCounter(const char* name, float value);
+
+		// average milliseconds over the frames that have results
+		float getAverage(int section, bool gpu);
+		// frame times in milliseconds, oldest first
+		void getFrameTimes(std::vector<float>& times);
+		const std::vector<std::string>& getSectionNames();
+		const std::vector<std::string>& getCounterNames();
+		float getCounter(int counter);
+
+		// writes every kept frame in the chrome://tracing JSON format
+		bool writeChromeTrace(const std::string& path);
+};
+
+// Times the enclosing block on the CPU, and on the GPU as well if gpu is set
+class ProfileScope {
+	Profiler& profiler;
+	int section;
+	double start;
+	GLuint query;
+
+	public:
+		ProfileScope(Profiler& profiler_, const char* name, bool gpu = false);
+		~ProfileScope();
+};
@@ -1,5 +1,6 @@
 #include "HUD.hpp"
 #include <algorithm>
+#include <cstdio>
 
 // some HUD constants
 const double CURSOR_RAD = 10;
@@ -11,11 +12,27 @@ const glm::vec4 HUD_BORDER_COLOUR = glm::vec4(0, 0, 0, 1);
 const glm::vec4 HUD_ITEM_DISPLAY_COLOUR = glm::vec4(0.4, 0.4, 0.4, 1);
 const glm::vec4 HUD_SELECTED_FLAME_COLOUR = glm::vec4(0, 0, 0, 1);
 const glm::vec4 HUD_MESSAGE_COLOUR = glm::vec4(1, 1, 1, 1);
+const glm::vec4 HUD_MESSAGE_OUTLINE_COLOUR = glm::vec4(0, 0, 0, 1);
+// profiler overlay
+const float PROFILER_WIDTH = 320;
+const float PROFILER_GRAPH_HEIGHT = 60;
+const float PROFILER_ROW_HEIGHT = 16;
+const float PROFILER_MARGIN = 10;
+const float PROFILER_TEXT_SCALE = 0.3;
+const float PROFILER_CPU_COLUMN = 130;
+const float PROFILER_GPU_COLUMN = 220;
+const float PROFILER_GRAPH_MAX_MS = 1000.0 / 30;	// the top of the graph is 30fps
+const float PROFILER_BUDGET_MS = 1000.0 / 60;
+const glm::vec4 PROFILER_BACKGROUND_COLOUR = glm::vec4(0.1, 0.1, 0.1, 1);
+const glm::vec4 PROFILER_GRAPH_COLOUR = glm::vec4(0.3, 1, 0.3, 1);
+const glm::vec4 PROFILER_BUDGET_COLOUR = glm::vec4(0.6, 0.6, 0.6, 1);
+const glm::vec4 PROFILER_TEXT_COLOUR = glm::vec4(1, 1, 1, 1);
 
-HUD::HUD(float wH, float wW, TextShader* textShader_, ShapeShader* shapeShader_, SpriteShader* spriteShader_)
+HUD::HUD(float wH, float wW, TextShader* textShader_, ShapeShader* shapeShader_, SpriteShader* spriteShader_,
+	Profiler* profiler_)
 	: windowH(wH), windowW(wW), shouldDraw(true), 
 	 textShader(textShader_), shapeShader(shapeShader_), spriteShader(spriteShader_),
-	messageOpacity(0) {}
+	profiler(profiler_), shouldDrawProfiler(false), messageOpacity(0) {}
 
 void HUD::displayMessage(std::string m) {
 	messageOpacity = 1;
@@ -51,17 +68,75 @@ void HUD::draw(GeometryNode* selectedObj, Flame selectedFlame) {
 	shapeShader->drawCircle(100, 100, 70,
 		HUD_BORDER_COLOUR, false);
 
-	// write the selected flame
-	textShader->renderText(selectedFlame.name, 185, 43,
+	// write the selected flame, text is batched and drawn last
+	textShader->queueText(selectedFlame.name, 185, 43,
 		0.7, HUD_SELECTED_FLAME_COLOUR);
 	float s = 60;
 	spriteShader->draw(100-s, 100-s, s*2, s*2, selectedFlame.spriteId);
 
-	// message
-	textShader->renderText(message, windowW / 3, windowH / 4,
-		0.8, glm::vec4(glm::vec3(HUD_MESSAGE_COLOUR), messageOpacity));
+	// message, outlined so it can be read over bright lanterns
+	textShader->queueText(message, windowW / 3, windowH / 4,
+		0.8, glm::vec4(glm::vec3(HUD_MESSAGE_COLOUR), messageOpacity),
+		glm::vec4(glm::vec3(HUD_MESSAGE_OUTLINE_COLOUR), messageOpacity));
+
+	if (shouldDrawProfiler) { drawProfiler(); }
+	textShader->flush();
+}
+
+void HUD::drawProfiler() {
+	const std::vector<std::string>& names = profiler->getSectionNames();
+	const std::vector<std::string>& counters = profiler->getCounterNames();
+	float height = PROFILER_GRAPH_HEIGHT + PROFILER_ROW_HEIGHT * (names.size() + counters.size() + 1)
+		+ PROFILER_MARGIN * 2;
+	float left = windowW - PROFILER_WIDTH - PROFILER_MARGIN;
+	float bot = windowH - height - PROFILER_MARGIN;
+	shapeShader->drawRect(left, bot, PROFILER_WIDTH, height, PROFILER_BACKGROUND_COLOUR, true);
+	shapeShader->drawRect(left, bot, PROFILER_WIDTH, height, HUD_BORDER_COLOUR, false);
+
+	// frame times along the top, with a line where 60fps is
+	float graphLeft = left + PROFILER_MARGIN;
+	float graphBot = bot + height - PROFILER_MARGIN - PROFILER_GRAPH_HEIGHT;
+	float graphW = PROFILER_WIDTH - PROFILER_MARGIN * 2;
+	std::vector<float> budget = { PROFILER_BUDGET_MS, PROFILER_BUDGET_MS };
+	shapeShader->drawGraph(graphLeft, graphBot, graphW, PROFILER_GRAPH_HEIGHT,
+		budget, PROFILER_GRAPH_MAX_MS, PROFILER_BUDGET_COLOUR);
+	profiler->getFrameTimes(frameTimes);
+	shapeShader->drawGraph(graphLeft, graphBot, graphW, PROFILER_GRAPH_HEIGHT,
+		frameTimes, PROFILER_GRAPH_MAX_MS, PROFILER_GRAPH_COLOUR);
+
+	// then a row for every section, averaged over the kept frames
+	char line[128];
+	float y = graphBot - PROFILER_ROW_HEIGHT;
+	float frameMs = frameTimes.empty() ? 0 : frameTimes.back();
+	snprintf(line, sizeof(line), "frame %.2f ms", frameMs);
+	textShader->queueText(line, graphLeft, y, PROFILER_TEXT_SCALE, PROFILER_TEXT_COLOUR);
+	textShader->queueText("cpu ms", graphLeft + PROFILER_CPU_COLUMN, y, PROFILER_TEXT_SCALE, PROFILER_TEXT_COLOUR);
+	textShader->queueText("gpu ms", graphLeft + PROFILER_GPU_COLUMN, y, PROFILER_TEXT_SCALE, PROFILER_TEXT_COLOUR);
+	for (int i = 0; i < names.size(); i++) {
+		y -= PROFILER_ROW_HEIGHT;
+		textShader->queueText(names[i], graphLeft, y, PROFILER_TEXT_SCALE, PROFILER_TEXT_COLOUR);
+		snprintf(line, sizeof(line), "%.2f", profiler->getAverage(i, false));
+		textShader->queueText(line, graphLeft + PROFILER_CPU_COLUMN, y, PROFILER_TEXT_SCALE, PROFILER_TEXT_COLOUR);
+		// sections without a query have no gpu time
+		float gpuMs = profiler->getAverage(i, true);
+		if (gpuMs > 0) {
+			snprintf(line, sizeof(line), "%.2f", gpuMs);
+			textShader->queueText(line, graphLeft + PROFILER_GPU_COLUMN, y, PROFILER_TEXT_SCALE, PROFILER_TEXT_COLOUR);
+		}
+	}
+	// and the latest value of every counter
+	for (int i = 0; i < counters.size(); i++) {
+		y -= PROFILER_ROW_HEIGHT;
+		textShader->queueText(counters[i], graphLeft, y, PROFILER_TEXT_SCALE, PROFILER_TEXT_COLOUR);
+		snprintf(line, sizeof(line), "%g", profiler->getCounter(i));
+		textShader->queueText(line, graphLeft + PROFILER_CPU_COLUMN, y, PROFILER_TEXT_SCALE, PROFILER_TEXT_COLOUR);
+	}
 }
 
 bool HUD::getShouldDraw() { return shouldDraw; }
 
 void HUD::setShouldDraw(bool sd) { shouldDraw = sd; }
+
+bool HUD::getShouldDrawProfiler() { return shouldDrawProfiler; }
+
+void HUD::setShouldDrawProfiler(bool sd) { shouldDrawProfiler = sd; }
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include "Shaders/ShadersImport.hpp"
 #include "FlameManager.hpp"
 #include "Objects/GeometryNode.hpp"
+#include "Application/Profiler.hpp"
 
 class HUD {
 	float windowH;
@@ -14,9 +15,16 @@ class HUD {
 	TextShader* textShader;
 	ShapeShader* shapeShader;
 	SpriteShader* spriteShader;
+
+	Profiler* profiler;
+	bool shouldDrawProfiler;
+	std::vector<float> frameTimes;
+	// frame time graph and the average time of each section, in the top right
+	void drawProfiler();
 	
 public:
-	HUD(float wH, float wW, TextShader* textShader_, ShapeShader* shapeShader_, SpriteShader* spriteShader_);
+	HUD(float wH, float wW, TextShader* textShader_, ShapeShader* shapeShader_, SpriteShader* spriteShader_,
+		Profiler* profiler_);
 
 	// CR-soon: maybe pass the project and call method sof project
 	void draw(GeometryNode* selectedObj, Flame selectedFlame);
@@ -26,4 +34,6 @@ public:
 
 	bool getShouldDraw();
 	void setShouldDraw(bool sd);
+	bool getShouldDrawProfiler();
+	void setShouldDrawProfiler(bool sd);
 };
@@ -0,0 +1,227 @@
+#include "BVH.hpp"
+#include "GeometryNode.hpp"
+
+#include <algorithm>
+#include <limits>
+
+// parameters for the binned SAH build
+const int NUM_SAH_BINS = 12;
+const int MAX_LEAF_PRIMS = 2;
+const float TRAVERSAL_COST = 1.0f;
+const float INTERSECT_COST = 1.0f;
+// max depth of the tree, so that traversal can use a fixed size stack
+const int MAX_STACK_DEPTH = 64;
+
+BVH::BVH() {}
+
+void BVH::collectGeometry(SceneNode* node) {
+	if (node == nullptr) { return; }
+	if (node->m_nodeType == NodeType::GeometryNode) {
+		GeometryNode* geometryNode = static_cast<GeometryNode*>(node);
+		prims.push_back(geometryNode);
+		primBoxes.push_back(geometryNode->getTransformedAABB());
+	}
+	for (SceneNode* child : node->children) {
+		collectGeometry(child);
+	}
+}
+
+void BVH::build(SceneNode* root) {
+	nodes.clear();
+	prims.clear();
+	primBoxes.clear();
+	collectGeometry(root);
+	if (prims.empty()) { return; }
+	nodes.reserve(2 * prims.size());
+	buildRecursive(0, prims.size(), 0);
+}
+
+AABB BVH::boundsOf(int first, int count) {
+	AABB box = primBoxes[first];
+	for (int i = first + 1; i < first + count; i++) {
+		box = box.merge(primBoxes[i]);
+	}
+	return box;
+}
+
+int BVH::buildRecursive(int first, int count, int depth) {
+	int index = nodes.size();
+	BVHNode node;
+	node.box = boundsOf(first, count);
+	node.left = -1;
+	node.right = -1;
+	node.firstPrim = first;
+	node.numPrims = count;
+	nodes.push_back(node);
+	if (count <= MAX_LEAF_PRIMS || depth >= MAX_STACK_DEPTH - 1) { return index; }
+
+	// split along the axis where the centroids are most spread out
+	glm::vec3 cMin = primBoxes[first].centroid();
+	glm::vec3 cMax = cMin;
+	for (int i = first + 1; i < first + count; i++) {
+		cMin = glm::min(cMin, primBoxes[i].centroid());
+		cMax = glm::max(cMax, primBoxes[i].centroid());
+	}
+	glm::vec3 extent = cMax - cMin;
+	int axis = 0;
+	if (extent.y > extent[axis]) { axis = 1; }
+	if (extent.z > extent[axis]) { axis = 2; }
+	// all centroids in the same spot, cannot split any further
+	if (extent[axis] <= 0) { return index; }
+
+	// bin the primitives by centroid
+	int binCounts[NUM_SAH_BINS] = { 0 };
+	AABB binBoxes[NUM_SAH_BINS];
+	float binScale = NUM_SAH_BINS / extent[axis];
+	auto binOf = [&](int i) {
+		int b = (int)((primBoxes[i].centroid()[axis] - cMin[axis]) * binScale);
+		return std::min(b, NUM_SAH_BINS - 1);
+	};
+	for (int i = first; i < first + count; i++) {
+		int b = binOf(i);
+		binBoxes[b] = binCounts[b] == 0 ? primBoxes[i] : binBoxes[b].merge(primBoxes[i]);
+		binCounts[b]++;
+	}
+
+	// sweep from the right to get the area/count of everything after each split
+	float rightArea[NUM_SAH_BINS];
+	int rightCount[NUM_SAH_BINS];
+	AABB acc;
+	int accCount = 0;
+	for (int b = NUM_SAH_BINS - 1; b > 0; b--) {
+		if (binCounts[b] > 0) {
+			acc = accCount == 0 ? binBoxes[b] : acc.merge(binBoxes[b]);
+			accCount += binCounts[b];
+		}
+		rightArea[b] = accCount == 0 ? 0 : acc.surfaceArea();
+		rightCount[b] = accCount;
+	}
+
+	// then sweep from the left to find the cheapest split
+	float bestCost = std::numeric_limits<float>::max();
+	int bestSplit = -1;
+	accCount = 0;
+	for (int b = 0; b < NUM_SAH_BINS - 1; b++) {
+		if (binCounts[b] > 0) {
+			acc = accCount == 0 ? binBoxes[b] : acc.merge(binBoxes[b]);
+			accCount += binCounts[b];
+		}
+		if (accCount == 0 || rightCount[b + 1] == 0) { continue; }
+		float cost = acc.surfaceArea() * accCount + rightArea[b + 1] * rightCount[b + 1];
+		if (cost < bestCost) {
+			bestCost = cost;
+			bestSplit = b;
+		}
+	}
+
+	// only split if it is cheaper than testing every primitive in a leaf
+	float parentArea = node.box.surfaceArea();
+	float leafCost = INTERSECT_COST * count;
+	float splitCost = TRAVERSAL_COST + INTERSECT_COST * bestCost / std::max(parentArea, 1e-6f);
+	if (bestSplit < 0 || splitCost >= leafCost) { return index; }
+
+	// partition the primitives around the split
+	int mid = first;
+	for (int i = first; i < first + count; i++) {
+		if (binOf(i) <= bestSplit) {
+			std::swap(prims[i], prims[mid]);
+			std::swap(primBoxes[i], primBoxes[mid]);
+			mid++;
+		}
+	}
+
+	int left = buildRecursive(first, mid - first, depth + 1);
+	int right = buildRecursive(mid, first + count - mid, depth + 1);
+	nodes[index].left = left;
+	nodes[index].right = right;
+	nodes[index].numPrims = 0;
+	return index;
+}
+
+bool BVH::refit() {
+	bool moved = false;
+	for (int i = 0; i < prims.size(); i++) {
+		const AABB& box = prims[i]->getTransformedAABB();
+		if (box != primBoxes[i]) {
+			primBoxes[i] = box;
+			moved = true;
+		}
+	}
+	if (!moved) { return false; }
+
+	// children always come after their parent, so go backwards to update bottom up
+	for (int i = nodes.size() - 1; i >= 0; i--) {
+		BVHNode& node = nodes[i];
+		if (node.left < 0) {
+			node.box = boundsOf(node.firstPrim, node.numPrims);
+		} else {
+			node.box = nodes[node.left].box.merge(nodes[node.right].box);
+		}
+	}
+	return true;
+}
+
+GeometryNode* BVH::checkIntersect(const AABB& other) {
+	if (nodes.empty()) { return nullptr; }
+	int stack[MAX_STACK_DEPTH];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0) {
+		const BVHNode& node = nodes[stack[--stackSize]];
+		if (!node.box.intersect(other)) { continue; }
+		if (node.left < 0) {
+			for (int i = node.firstPrim; i < node.firstPrim + node.numPrims; i++) {
+				if (primBoxes[i].intersect(other)) { return prims[i]; }
+			}
+		} else {
+			stack[stackSize++] = node.right;
+			stack[stackSize++] = node.left;
+		}
+	}
+	return nullptr;
+}
+
+void BVH::getAllIntersections(const AABB& other, std::vector<GeometryNode*>& result) {
+	if (nodes.empty()) { return; }
+	int stack[MAX_STACK_DEPTH];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0) {
+		const BVHNode& node = nodes[stack[--stackSize]];
+		if (!node.box.intersect(other)) { continue; }
+		if (node.left < 0) {
+			for (int i = node.firstPrim; i < node.firstPrim + node.numPrims; i++) {
+				if (primBoxes[i].intersect(other)) { result.push_back(prims[i]); }
+			}
+		} else {
+			stack[stackSize++] = node.right;
+			stack[stackSize++] = node.left;
+		}
+	}
+}
+
+void BVH::getAllRayIntersections(const glm::vec3& origin, const glm::vec3& dir, float maxDist, std::vector<RayHit>& result) {
+	if (nodes.empty()) { return; }
+	glm::vec3 invDir = 1.0f / dir;
+	float t;
+
+	int stack[MAX_STACK_DEPTH];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0) {
+		const BVHNode& node = nodes[stack[--stackSize]];
+		if (!node.box.intersectRay(origin, invDir, maxDist, t)) { continue; }
+		if (node.left < 0) {
+			for (int i = node.firstPrim; i < node.firstPrim + node.numPrims; i++) {
+				if (primBoxes[i].intersectRay(origin, invDir, maxDist, t)) { result.push_back({ t, prims[i] }); }
+			}
+		} else {
+			stack[stackSize++] = node.right;
+			stack[stackSize++] = node.left;
+		}
+	}
+}
+
+int BVH::getNumNodes() { return nodes.size(); }
+
+bool BVH::isEmpty() { return nodes.empty(); }
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "SceneNode.hpp"
+#include "../Application/AABB.hpp"
+
+#include <vector>
+
+class GeometryNode;
+
+// a node in the flattened hierarchy. Interior nodes store the index of their
+// children, leaves store a range into the primitive array
+struct BVHNode {
+	AABB box;
+	int left;				// -1 if leaf
+	int right;
+	int firstPrim;
+	int numPrims;
+};
+
+// a node whose AABB is hit by a ray, t is where the ray enters the AABB
+struct RayHit {
+	float t;
+	GeometryNode* node;
+};
+
+// Bounding volume hierarchy over the transformed AABBs of every GeometryNode
+// in a scene tree. Built once using the surface area heuristic, then refit
+// whenever the geometry moves.
+class BVH {
+	std::vector<BVHNode> nodes;					// root is nodes[0], children after parents
+	std::vector<GeometryNode*> prims;
+	std::vector<AABB> primBoxes;				// boxes as of the last build/refit
+
+	// helpers
+	void collectGeometry(SceneNode* node);
+	int buildRecursive(int first, int count, int depth);
+	AABB boundsOf(int first, int count);
+
+	public:
+		BVH();
+
+		// rebuilds the hierarchy from scratch, expects transformedAABBs to be up to date
+		void build(SceneNode* root);
+		// updates the bounds of the hierarchy if any node moved.
+		// returns true iff some node moved
+		bool refit();
+
+		// returns any node that intersects the given AABB, null if none
+		GeometryNode* checkIntersect(const AABB& other);
+		// appends every node that intersects the given AABB
+		void getAllIntersections(const AABB& other, std::vector<GeometryNode*>& result);
+		// appends every node whose AABB is hit by the ray within maxDist, in no particular order.
+		// dir does not need to be normalized, t is in units of dir
+		void getAllRayIntersections(const glm::vec3& origin, const glm::vec3& dir, float maxDist, std::vector<RayHit>& result);
+
+		int getNumNodes();
+		bool isEmpty();
+};
@@ -0,0 +1,103 @@
+#include "EmissionScheduler.hpp"
+#include "Lantern.hpp"
+#include "../Application/Frustum.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// emitters further than this do not spawn anything
+const float MAX_EMIT_DISTANCE = 60;
+// an emitter covering this fraction of the screen height, or more, gets full detail
+const float FULL_DETAIL_COVERAGE = 0.1;
+// visible emitters never drop below this
+const float MIN_VISIBLE_WEIGHT = 0.1;
+// emitters behind the camera keep a trickle going, so turning around does not show an empty flame
+const float HIDDEN_WEIGHT = 0.05;
+const float MIN_LIFE_SCALE = 0.5;
+const float MAX_SIZE_SCALE = 2;
+// leave room for spawns that land before older particles die
+const float BUDGET_HEADROOM = 0.9;
+
+EmitterLod::EmitterLod() :
+	weight(1), spawnScale(1), lifeScale(1), sizeScale(1), visible(true) {}
+
+EmissionStats::EmissionStats() :
+	budget(0), liveParticles(0), fullDemand(0), scheduledDemand(0), spawned(0), dropped(0) {}
+
+EmissionScheduler::EmissionScheduler() : projection(1), tanHalfFovY(1) {}
+
+void EmissionScheduler::setProjection(const glm::mat4& P) {
+	projection = P;
+	tanHalfFovY = 1 / P[1][1];
+}
+
+void EmissionScheduler::schedule(const std::vector<Lantern*>& lanterns, glm::vec3 viewPos, const glm::mat4& V,
+	unsigned int liveParticles, unsigned int budget, float tickLength)
+{
+	Frustum frustum(projection * V);
+	lods.resize(lanterns.size());
+	stats.emitterCounts.resize(lanterns.size());
+	stats.budget = budget;
+	stats.liveParticles = liveParticles;
+	stats.fullDemand = 0;
+
+	// weigh every emitter, and see how much it would keep alive at that weight
+	float weightedDemand = 0;
+	float spawnsPerTick = 0;
+	for (unsigned int i = 0; i < lanterns.size(); i++) {
+		EmitterLod& lod = lods[i];
+		glm::vec3 center;
+		float radius;
+		lanterns[i]->getEmitterBounds(center, radius);
+		float dist = glm::length(center - viewPos);
+
+		lod.visible = frustum.intersectSphere(center, radius);
+		if (dist > MAX_EMIT_DISTANCE) { lod.weight = 0; }
+		else {
+			// fraction of the screen height the emitter covers
+			float coverage = radius / (std::max(dist, radius) * tanHalfFovY);
+			lod.weight = lod.visible ?
+				glm::clamp(coverage / FULL_DETAIL_COVERAGE, MIN_VISIBLE_WEIGHT, 1.0f) : HIDDEN_WEIGHT;
+		}
+		lod.lifeScale = glm::mix(MIN_LIFE_SCALE, 1.0f, lod.weight);
+		lod.spawnScale = lod.weight;
+
+		float fullDemand = lanterns[i]->getFullDemand(tickLength);
+		stats.fullDemand += fullDemand;
+		weightedDemand += fullDemand * lod.spawnScale * lod.lifeScale;
+		spawnsPerTick += lanterns[i]->getFullSpawnsPerTick() * lod.spawnScale;
+	}
+
+	// everyone gives up the same share when the weighted demand does not fit
+	float scale = 1;
+	if (weightedDemand > budget * BUDGET_HEADROOM) {
+		scale = budget * BUDGET_HEADROOM / weightedDemand;
+	}
+	// and never spawn more in one tick than there is room for
+	float freeSlots = budget > liveParticles ? (float)(budget - liveParticles) : 0;
+	if (spawnsPerTick * scale > freeSlots) {
+		scale = freeSlots / spawnsPerTick;
+	}
+
+	stats.scheduledDemand = 0;
+	for (unsigned int i = 0; i < lanterns.size(); i++) {
+		EmitterLod& lod = lods[i];
+		lod.spawnScale *= scale;
+		float coverage = lod.spawnScale * lod.lifeScale;
+		lod.sizeScale = coverage > 0 ? glm::clamp(1 / std::sqrt(coverage), 1.0f, MAX_SIZE_SCALE) : 1;
+		stats.scheduledDemand += lanterns[i]->getFullDemand(tickLength) * coverage;
+		stats.emitterCounts[i] = 0;
+	}
+	stats.spawned = 0;
+}
+
+void EmissionScheduler::recordEmission(unsigned int emitter, unsigned int count) {
+	stats.emitterCounts[emitter] = count;
+	stats.spawned += count;
+}
+
+void EmissionScheduler::setDropped(unsigned int dropped) { stats.dropped = dropped; }
+
+const EmitterLod& EmissionScheduler::getLod(unsigned int emitter) const { return lods[emitter]; }
+
+const EmissionStats& EmissionScheduler::getStats() const { return stats; }
@@ -0,0 +1,53 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+
+class Lantern;
+
+// what an emitter is allowed to spawn this tick
+struct EmitterLod {
+	float weight;			// importance from distance, visibility and projected size, 0 to 1
+	float spawnScale;		// fraction of the full spawn count, after the budget is applied
+	float lifeScale;
+	float sizeScale;		// fewer particles are drawn larger to cover the same area
+	bool visible;
+	EmitterLod();
+};
+
+struct EmissionStats {
+	unsigned int budget;				// size of the particle pool
+	unsigned int liveParticles;			// at the start of the tick
+	float fullDemand;					// live particles if every emitter ran at full detail
+	float scheduledDemand;				// live particles at the scheduled detail
+	unsigned int spawned;				// last tick
+	unsigned int dropped;				// spawns the pool had no room for, since the start
+	std::vector<unsigned int> emitterCounts;	// spawns per emitter last tick
+	EmissionStats();
+};
+
+// Shares the particle pool between the lanterns. Each emitter is weighted by
+// its distance to the player, whether it is in the view frustum and how large it
+// is on screen, and the pool is split in proportion. An emitter's full detail demand
+// is the number of particles it keeps alive at steady state; when the weighted demand
+// does not fit, every emitter is scaled down by the same factor rather than the
+// pool silently dropping whatever comes last
+class EmissionScheduler {
+	glm::mat4 projection;
+	float tanHalfFovY;
+	std::vector<EmitterLod> lods;
+	EmissionStats stats;
+
+	public:
+		EmissionScheduler();
+		void setProjection(const glm::mat4& P);
+
+		// picks every lantern's detail for this tick
+		void schedule(const std::vector<Lantern*>& lanterns, glm::vec3 viewPos, const glm::mat4& V,
+			unsigned int liveParticles, unsigned int budget, float tickLength);
+		// records what was actually spawned, for the stats
+		void recordEmission(unsigned int emitter, unsigned int count);
+		void setDropped(unsigned int dropped);
+
+		const EmitterLod& getLod(unsigned int emitter) const;
+		const EmissionStats& getStats() const;
+};
@@ -1,4 +1,5 @@
 #include "GeometryNode.hpp"
+#include "SceneStore.hpp"
 
 //---------------------------------------------------------------------------------------
 GeometryNode::GeometryNode(
@@ -10,7 +11,8 @@ GeometryNode::GeometryNode(
 	objType(ObjectType::Basic),
 	textureId(0),
 	materialType(MaterialType::Plain),
-	baseAABB(aabb)
+	baseAABB(aabb),
+	isOccluder(false)
 {
 	m_nodeType = NodeType::GeometryNode;
 }
@@ -18,21 +20,33 @@ GeometryNode::GeometryNode(
 void GeometryNode::setMaterial(Material m) {
 	material = m;
 	materialType = MaterialType::Plain;
+	// material handles need to be recomputed
+	if (store != nullptr) { store->invalidate(); }
 }
 
 void GeometryNode::setTexture(GLuint id) {
 	textureId = id;
 	materialType = MaterialType::Texture;
+	if (store != nullptr) { store->invalidate(); }
+}
+
+void GeometryNode::setIsOccluder(bool b) {
+	isOccluder = b;
+	if (store != nullptr) { store->invalidate(); }
 }
 
 ObjectType GeometryNode::getObjectType() { return objType; }
 
-void GeometryNode::updateGlobalPos(glm::mat4 curM) {
-	transformedAABB = baseAABB.transform(curM*trans);
-	SceneNode::updateGlobalPos(curM);
+const AABB& GeometryNode::getTransformedAABB() const {
+	if (store != nullptr) { return store->worldAABBs[storeIndex]; }
+	return transformedAABB;
+}
+
+void GeometryNode::onWorldTransformChanged() {
+	transformedAABB = baseAABB.transform(worldTrans);
 }
 
 GeometryNode* GeometryNode::checkIntersect(AABB& other) {
-	if (transformedAABB.intersect(other)) { return this; }
+	if (getTransformedAABB().intersect(other)) { return this; }
 	return SceneNode::checkIntersect(other);
 }
\ No newline at end of file
@@ -32,17 +32,26 @@ class GeometryNode : public SceneNode {
 		GLuint textureId;
 
 		AABB baseAABB;				// AABB of the underlying mesh
-		AABB transformedAABB;		// AABB after all transformations
+		// the mesh is a solid box filling baseAABB, so it hides whatever is behind it
+		bool isOccluder;
 
 		// Mesh Identifier. This must correspond to an object name of
 		// a loaded .obj file.
 		std::string meshId;
 
 		ObjectType getObjectType();
+		// AABB after all transformations
+		const AABB& getTransformedAABB() const;
 
 		void setMaterial(Material m);
 		void setTexture(GLuint id);
+		void setIsOccluder(bool b);
 
 		virtual GeometryNode* checkIntersect(AABB& other) override;
-		virtual void updateGlobalPos(glm::mat4 curM) override;
+
+		friend class SceneStore;
+
+	protected:
+		AABB transformedAABB;		// only used while not part of a SceneStore
+		virtual void onWorldTransformChanged() override;
 };
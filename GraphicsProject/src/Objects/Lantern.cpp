@@ -14,6 +14,15 @@ const glm::vec3 DELTA_INTENSITY = MAX_INTENSITY / TIME_TO_MAX_INTENSITY;
 const glm::vec3 LANTERN_ATTENUTATION_VALUES = glm::vec3(1, 0, 0.005);
 // the larger the scale value, the faster the flame sound decreases in volume as you move farther away
 const float SOUND_SCALE_VALUE = 1;	
+// particles per tick at full detail, and their average lives
+const int BORDER_PARTICLES = 4;
+const int OUTER_FLAME_PARTICLES = 5;
+const int INNER_FLAME_PARTICLES = 4;
+const float BORDER_MEAN_LIFE = 3;
+const float OUTER_FLAME_MEAN_LIFE = 1.25;
+const float INNER_FLAME_MEAN_LIFE = 1.4;
+// the flame particles stay within this distance of the light
+const float FLAME_RADIUS = 0.5;
 
 Lantern::Lantern(std::string name, float maxR, AABB aabb_)
     : GeometryNode(MESH_ID, name, aabb_), maxRadius(maxR),
@@ -24,6 +33,7 @@ Lantern::Lantern(std::string name, float maxR, AABB aabb_)
     objType = ObjectType::Lantern;
     material = GRAY;
 	lanternLight.attenuationVals = LANTERN_ATTENUTATION_VALUES;
+	for (int i = 0; i < 3; i++) { spawnCarry[i] = 0; }
 }
 
 // GETTERS
@@ -32,7 +42,7 @@ float Lantern::getRadius() { return radius; }
 Flame Lantern::getFlame() { return flame; }
 PointLight* Lantern::getLightSource() { return &lanternLight;  }
 
-void Lantern::tick(float elapsedTime, ParticleShader* particleManager, glm::vec3 playerPos) {
+void Lantern::tick(float elapsedTime, glm::vec3 playerPos) {
     // move ROI up and down if activating/deactivating
     // normal flames do not have a ROI
     if (activated && radius < maxRadius && flame.id != LANTERN_NORMAL) {
@@ -41,26 +51,51 @@ void Lantern::tick(float elapsedTime, ParticleShader* particleManager, glm::vec3
         radius = std::max(0.0f, (float)(radius - GROW_RATE * elapsedTime));
     }
 
+	// update the volume of the ambient lantern flame sound based on the position of the player
+	if (activated && flameSound != nullptr) {
+		glm::vec3 dis = getSoundDistance(playerPos);
+		flameSound->setPosition(irrklang::vec3df(
+			dis.x, dis.y, dis.y
+		));
+	}
+
+	// update the intensity/position of the flame
+	if (activated) { lanternLight.rgbIntensity += DELTA_INTENSITY*elapsedTime;}
+	else { lanternLight.rgbIntensity -= DELTA_INTENSITY*elapsedTime; }
+	lanternLight.rgbIntensity = glm::clamp(lanternLight.rgbIntensity, glm::vec3(0, 0, 0), MAX_INTENSITY);
+	lanternLight.position = getLightGlobalPos();
+}
+
+// scales a full detail count, keeping the leftover fraction for the next tick
+static int scaleCount(int full, float scale, float& carry) {
+    float exact = full * scale + carry;
+    int n = (int)exact;
+    carry = exact - n;
+    return n;
+}
+
+void Lantern::emitParticles(std::vector<ParticleSpawn>& spawns, const EmitterLod& lod) {
 	// create border particles
     glm::vec3 lightPos = getLightGlobalPos();
     if (radius > 0.1) {
-        for (int i=0; i<4; i++) {
+        int n = scaleCount(BORDER_PARTICLES, lod.spawnScale, spawnCarry[0]);
+        for (int i=0; i<n; i++) {
             float x = randRange(-1, 1);
             float y = randRange(-1, 1);
             float z = randRange(-1, 1);
             glm::vec3 offSet = glm::normalize(glm::vec3(x, y, z))*radius;
             glm::vec3 v = glm::vec3(0, 1, 0)*randRange(0.01, 0.1);
-            float s = randRange(0.005, 0.01);
-            float l = randRange(2, 4);
-            particleManager -> addParticle(lightPos+offSet, LANTERN_BORDER_COLOUR,
-                glm::vec4(0), v, s, l);
+            float s = randRange(0.005, 0.01)*lod.sizeScale;
+            float l = randRange(2, 4)*lod.lifeScale;
+            spawns.push_back({ lightPos+offSet, LANTERN_BORDER_COLOUR, glm::vec4(0), v, s, l });
         }
     }
 
     // create some flame particles
     if (activated) {
         // spawn an outer colour particle
-        for (int i=0; i<5; i++) {
+        int nOuter = scaleCount(OUTER_FLAME_PARTICLES, lod.spawnScale, spawnCarry[1]);
+        for (int i=0; i<nOuter; i++) {
             float vX = randRange(-0.1, 0.1);
             float vZ = randRange(-0.1, 0.1);
             float speed = randRange(0.01, 1);
@@ -70,12 +105,13 @@ void Lantern::tick(float elapsedTime, ParticleShader* particleManager, glm::vec3
             float y = randRange(0, 0.1);
             glm::vec3 offSet = glm::normalize(glm::vec3(sin(theta), y, cos(theta)))*r;
             glm::vec4 f = glm::vec4(0, 0, 0, randRange(-0.8, -0.4));
-            float s = randRange(0.03, 0.05);
-            float l = randRange(1, 1.5);
-            particleManager -> addParticle(lightPos+offSet, flame.outerColour, f, v, s, l);
+            float s = randRange(0.03, 0.05)*lod.sizeScale;
+            float l = randRange(1, 1.5)*lod.lifeScale;
+            spawns.push_back({ lightPos+offSet, flame.outerColour, f, v, s, l });
         }
         // spawn an inner colour particle
-        for (int i=0; i<4; i++) {
+        int nInner = scaleCount(INNER_FLAME_PARTICLES, lod.spawnScale, spawnCarry[2]);
+        for (int i=0; i<nInner; i++) {
             float vX = randRange(-0.06, 0.06);
             float vZ = randRange(-0.06, 0.06);
             float speed = randRange(0.01, 0.5);
@@ -85,25 +121,33 @@ void Lantern::tick(float elapsedTime, ParticleShader* particleManager, glm::vec3
             float y = randRange(0, 0.1);
             glm::vec3 offSet = glm::normalize(glm::vec3(sin(theta), y, cos(theta)))*r;
             glm::vec4 f = glm::vec4(0, 0, 0, randRange(-0.8, -0.4));
-            float l = randRange(1, 1.8);
-            float s = randRange(0.03, 0.04);
-            particleManager -> addParticle(lightPos+offSet, flame.innerColour, f, v, s, l);
+            float l = randRange(1, 1.8)*lod.lifeScale;
+            float s = randRange(0.03, 0.04)*lod.sizeScale;
+            spawns.push_back({ lightPos+offSet, flame.innerColour, f, v, s, l });
         }
     }
+}
 
-	// update the volume of the ambient lantern flame sound based on the position of the player
-	if (activated && flameSound != nullptr) {
-		glm::vec3 dis = getSoundDistance(playerPos);
-		flameSound->setPosition(irrklang::vec3df(
-			dis.x, dis.y, dis.y
-		));
-	}
+void Lantern::getEmitterBounds(glm::vec3& center, float& r) {
+    center = getLightGlobalPos();
+    r = std::max(radius, FLAME_RADIUS);
+}
 
-	// update the intensity/position of the flame
-	if (activated) { lanternLight.rgbIntensity += DELTA_INTENSITY*elapsedTime;}
-	else { lanternLight.rgbIntensity -= DELTA_INTENSITY*elapsedTime; }
-	lanternLight.rgbIntensity = glm::clamp(lanternLight.rgbIntensity, glm::vec3(0, 0, 0), MAX_INTENSITY);
-	lanternLight.position = getLightGlobalPos();
+float Lantern::getFullSpawnsPerTick() {
+    float n = 0;
+    if (radius > 0.1) { n += BORDER_PARTICLES; }
+    if (activated) { n += OUTER_FLAME_PARTICLES + INNER_FLAME_PARTICLES; }
+    return n;
+}
+
+float Lantern::getFullDemand(float tickLength) {
+    // a particle spawned every tick lives for life/tickLength ticks
+    float alive = 0;
+    if (radius > 0.1) { alive += BORDER_PARTICLES * BORDER_MEAN_LIFE; }
+    if (activated) {
+        alive += OUTER_FLAME_PARTICLES * OUTER_FLAME_MEAN_LIFE + INNER_FLAME_PARTICLES * INNER_FLAME_MEAN_LIFE;
+    }
+    return alive / tickLength;
 }
 
 glm::vec3 Lantern::getSoundDistance(glm::vec3 playerPos) {
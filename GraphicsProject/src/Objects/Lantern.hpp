@@ -5,6 +5,7 @@
 #include "../SoundManager.hpp"
 #include "../FlameManager.hpp"
 #include "LightSource.hpp"
+#include "EmissionScheduler.hpp"
 
 class Lantern : public GeometryNode {
     float radius;
@@ -13,12 +14,21 @@ class Lantern : public GeometryNode {
     Flame flame;
 	irrklang::ISound* flameSound;
 	PointLight lanternLight;
+	// fractions of a particle left over from scaled down ticks, one per kind of particle
+	float spawnCarry[3];
 
 	glm::vec3 getSoundDistance(glm::vec3 playerPos);
 
     public: 
         Lantern(std::string name, float maxR, AABB aabb_);
-        void tick(float elapsedTime, ParticleShader* particleManager, glm::vec3 playerPos);
+        void tick(float elapsedTime, glm::vec3 playerPos);
+        // appends this tick's particles at the given detail, safe to run in a job once tick is done
+        void emitParticles(std::vector<ParticleSpawn>& spawns, const EmitterLod& lod);
+        // for the emission scheduler: where the particles appear,
+        // how many spawn per tick at full detail, and how many that keeps alive
+        void getEmitterBounds(glm::vec3& center, float& r);
+        float getFullSpawnsPerTick();
+        float getFullDemand(float tickLength);
         bool getIsActivated();
         float getRadius();
         Flame getFlame();
@@ -0,0 +1,47 @@
+#include "NodeRegistry.hpp"
+#include "SceneNode.hpp"
+
+NodeRegistry::NodeRegistry() : numNodes(0) {}
+
+NodeRegistry::~NodeRegistry() {
+	// the nodes may outlive the registry, so make sure they stop referring to it
+	for (Entry& entry : entries) {
+		if (entry.node != nullptr) { entry.node->registry = nullptr; }
+	}
+}
+
+void NodeRegistry::add(SceneNode* node) {
+	unsigned int id = node->m_nodeId;
+	if (id >= entries.size()) { entries.resize(id + 1, { nullptr, 0 }); }
+	if (entries[id].node == node) { return; }
+	entries[id].node = node;
+	numNodes++;
+}
+
+void NodeRegistry::remove(SceneNode* node) {
+	unsigned int id = node->m_nodeId;
+	if (id >= entries.size() || entries[id].node != node) { return; }
+	entries[id].node = nullptr;
+	entries[id].generation++;
+	numNodes--;
+}
+
+SceneNode* NodeRegistry::get(unsigned int id) const {
+	if (id >= entries.size()) { return nullptr; }
+	return entries[id].node;
+}
+
+SceneNode* NodeRegistry::get(NodeHandle handle) const {
+	if (handle.id >= entries.size()) { return nullptr; }
+	const Entry& entry = entries[handle.id];
+	if (entry.generation != handle.generation) { return nullptr; }
+	return entry.node;
+}
+
+NodeHandle NodeRegistry::getHandle(SceneNode* node) const {
+	unsigned int id = node->m_nodeId;
+	unsigned int generation = id < entries.size() ? entries[id].generation : 0;
+	return { id, generation };
+}
+
+int NodeRegistry::size() const { return numNodes; }
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vector>
+
+class SceneNode;
+
+// refers to a node for as long as it stays in the tree it was registered in
+struct NodeHandle {
+	unsigned int id;
+	unsigned int generation;
+};
+// refers to no node, always resolves to null
+const NodeHandle NULL_NODE_HANDLE = { 0xFFFFFFFF, 0 };
+
+// Constant time lookup from a node id to a node in the scene tree. Entries live in
+// a dense array indexed by SceneNode::m_nodeId, and each entry has a generation
+// that is bumped whenever its node leaves the tree, so stale handles resolve to null.
+// Kept up to date by SceneNode::add_child, remove_child and the SceneNode destructor.
+class NodeRegistry {
+	struct Entry {
+		SceneNode* node;
+		unsigned int generation;
+	};
+	std::vector<Entry> entries;
+	int numNodes;
+
+	public:
+		NodeRegistry();
+		~NodeRegistry();
+
+		void add(SceneNode* node);
+		void remove(SceneNode* node);
+
+		// returns nullptr if no node with this id is in the tree
+		SceneNode* get(unsigned int id) const;
+		// returns nullptr if the node has left the tree since the handle was made
+		SceneNode* get(NodeHandle handle) const;
+		NodeHandle getHandle(SceneNode* node) const;
+		int size() const;
+};
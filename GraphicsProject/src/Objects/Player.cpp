@@ -102,26 +102,39 @@ bool Player::tryMoveComponentWithYLeniency(Scene* scene, glm::vec3 v) {
 		newPos.y - HEIGHT * 0.5, newPos.y + HEIGHT * 0.5,
 		newPos.z - WIDTH * 0.5, newPos.z + WIDTH * 0.5
 	);
-	GeometryNode* possibleIntersect = scene->checkIntersect(aabb);
+	// query once with the box stretched up by the step limit. That covers
+	// everything the stepped up box could hit, so no need to query again
+	AABB stepAABB = aabb;
+	stepAABB.maxY += STEP_UP_LIMIT + EPSILON;
+	nearbyNodes.clear();
+	scene->getAllIntersections(stepAABB, nearbyNodes);
+
+	// step over the highest object we are running into
+	bool isIntersecting = false;
+	float yDiff = 0;
+	for (GeometryNode* node : nearbyNodes) {
+		if (node->getTransformedAABB().intersect(aabb)) {
+			isIntersecting = true;
+			yDiff = std::max(yDiff, node->getTransformedAABB().maxY - aabb.minY + EPSILON);
+		}
+	}
 	// if not interecting with any object, move is successful
-	if (possibleIntersect == nullptr) {
+	if (!isIntersecting) {
 		position = newPos;
 		return true;
 	}
-	float yDiff = possibleIntersect->transformedAABB.maxY - aabb.minY + EPSILON;
 	// if we cannot step over to the colliding object, we cannot move through it
-	if (yDiff < 0 || yDiff > STEP_UP_LIMIT) {
+	if (yDiff > STEP_UP_LIMIT) {
 		return false;
 	}
 	aabb.maxY += yDiff;
 	aabb.minY += yDiff;
-	GeometryNode* possibleStillIntersect = scene->checkIntersect(aabb);
-	// if we can walk if we were to move slightly upward, then move slightly upward
-	if (possibleStillIntersect == nullptr) {
-		position = newPos + glm::vec3(0, yDiff, 0);
-		return true;
+	for (GeometryNode* node : nearbyNodes) {
+		if (node->getTransformedAABB().intersect(aabb)) { return false; }
 	}
-	return false;
+	// if we can walk if we were to move slightly upward, then move slightly upward
+	position = newPos + glm::vec3(0, yDiff, 0);
+	return true;
 }
 
 void Player::tick(float elapsedTime) {
@@ -184,6 +197,13 @@ glm::mat4 Player::getViewMatrix() {
 
 glm::vec3 Player::getViewPos() { return position + EYE_OFFSET; }
 
+glm::vec3 Player::getViewDirection() {
+    // the camera looks down -z before being rotated, same rotations as getViewMatrix
+    glm::mat4 pitchM = glm::rotate(glm::mat4(1), pitchAngle, glm::vec3(1, 0, 0));
+    glm::mat4 yawM = glm::rotate(glm::mat4(1), yawAngle, glm::vec3(0, 1, 0));
+    return glm::normalize(glm::vec3(yawM*pitchM*glm::vec4(0, 0, -1, 0)));
+}
+
 void Player::togglePlayerMode(PlayerMode m) { mode = m; }
 
 PlayerMode Player::getPlayerMode() { return mode;  }
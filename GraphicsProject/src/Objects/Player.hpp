@@ -1,8 +1,10 @@
 #pragma once
 #include "../SoundManager.hpp"
 #include <glm/glm.hpp>
+#include <vector>
 
 class Scene;					// forward declaration
+class GeometryNode;
 
 // player can fly, ghost through objects, or walk
 enum class PlayerMode {
@@ -21,6 +23,7 @@ class Player {
 	bool isMovingLaterally;
 	bool isInAir;
 	irrklang::ISound* walkingSound;
+	std::vector<GeometryNode*> nearbyNodes;		// reused between collision queries
 
 	// helper functions
 	bool tryMoveComponent(Scene* scene, glm::vec3 v);
@@ -49,5 +52,7 @@ class Player {
 		PlayerMode getPlayerMode();
 		glm::mat4 getViewMatrix();
         glm::vec3 getViewPos();
+		// unit vector the camera is looking along
+		glm::vec3 getViewDirection();
 
 };
\ No newline at end of file
@@ -4,10 +4,16 @@
 
 #include <glm/glm.hpp>
 #include <string>
+#include <algorithm>
 #include <glm/gtc/matrix_transform.hpp>
 
-Scene::Scene(ParticleShader* pm):
-    root(nullptr), player(nullptr), particleManager(pm) {}
+const unsigned long long DEFAULT_RANDOM_SEED = 488;
+// emitting is cheap, so give each job a few lanterns
+const unsigned int LANTERNS_PER_JOB = 4;
+
+Scene::Scene(ParticleShader* pm, JobSystem* js):
+    root(nullptr), player(nullptr), particleManager(pm), jobSystem(js),
+	randomSeed(DEFAULT_RANDOM_SEED), tickCount(0) {}
 
 Scene::~Scene() {
     if (root != nullptr) {
@@ -44,6 +50,12 @@ void setMaterial(SceneNode* baseNode, Material m) {
 	meshNode->setMaterial(m);
 }
 
+// for solid boxes, like walls, that hide what is behind them
+void setOccluder(SceneNode* baseNode) {
+	GeometryNode* meshNode = static_cast<GeometryNode*>(baseNode->children.front());
+	meshNode->setIsOccluder(true);
+}
+
 // MATERIALS
 Material lightGray(glm::vec4(0.85, 0.85, 0.85, 1), glm::vec3(0.3, 0.3, 0.3), 25.0);
 Material ground(glm::vec4(0.3, 0.6, 0.3, 1), glm::vec3(0.1, 0.1, 0.1), 10.0);
@@ -90,7 +102,7 @@ SceneNode* Scene::generateShapeScene() {
 	root->add_child(tgNode);
 
 	// TODO: make helper function
-	Lantern* lantern = new Lantern("mylantern", 5, batchInfoMap["mylantern"].aabb);
+	Lantern* lantern = new Lantern("mylantern", 5, batchInfoMap["lantern1"].aabb);
 	lantern->translate(glm::vec3(0, 0, -1));
 	root->add_child(lantern);
 	lanterns.push_back(lantern);
@@ -120,21 +132,25 @@ SceneNode* Scene::generateRoomScene() {
 	SceneNode* floor = createNodeRotateMesh("same_side_cube", "roomfloor",
 		glm::vec3(0.5, 0.02, 2), glm::vec3(4.5, 0.05, 6), 0);
 	setTexture(floor, "FloorWood", textureManager);
+	setOccluder(floor);
 	root->add_child(floor);
 
 	SceneNode* crate1 = createNodeRotateMesh("same_side_cube", "roomcrate1",
 		glm::vec3(1.65, 0.5, 3.9), glm::vec3(1, 1, 1), 45);
 	setTexture(crate1, "Crate", textureManager);
+	setOccluder(crate1);
 	root->add_child(crate1);
 
 	SceneNode* crate2 = createNodeRotateMesh("same_side_cube", "roomcrate2",
 		glm::vec3(0.2, 0.9, 0.2), glm::vec3(0.8, 0.8, 0.8), 60);
 	setTexture(crate2, "Crate", textureManager);
+	setOccluder(crate2);
 	crate1->add_child(crate2);
 
 	SceneNode* leftWall = createNodeRotateMesh("same_side_cube", "roomLW",
 		glm::vec3(-1.8, 1.75, 2), glm::vec3(0.2, 3.5, 6), 0);
 	setTexture(leftWall, "WallWood", textureManager);
+	setOccluder(leftWall);
 	root->add_child(leftWall);
 
 	SceneNode* painting = createNodeRotateMesh("same_side_cube", "painting",
@@ -145,6 +161,7 @@ SceneNode* Scene::generateRoomScene() {
 	SceneNode* rightWall = createNodeRotateMesh("same_side_cube", "roomRW",
 		glm::vec3(2.7, 1.75, 2), glm::vec3(0.2, 3.5, 6), 0);
 	setTexture(rightWall, "WallWood", textureManager);
+	setOccluder(rightWall);
 	root->add_child(rightWall);
 
 	SceneNode* a4 = createNodeRotateMesh("same_side_cube", "a4",
@@ -155,6 +172,7 @@ SceneNode* Scene::generateRoomScene() {
 	SceneNode* backWallL = createNodeRotateMesh("same_side_cube", "backWallL",
 		glm::vec3(-1.25, 1.75, -1), glm::vec3(1, 3.5, 0.2), 0);
 	setTexture(backWallL, "WallWood", textureManager);
+	setOccluder(backWallL);
 	root->add_child(backWallL);
 
 	SceneNode* monkeyNode = createNodeRotateMesh("monkey", "monkey",
@@ -165,11 +183,13 @@ SceneNode* Scene::generateRoomScene() {
 	SceneNode* backWallR = createNodeRotateMesh("same_side_cube", "backWallR",
 		glm::vec3(2.5, 1.75, -1), glm::vec3(0.5, 3.5, 0.2), 0);
 	setTexture(backWallR, "WallWood", textureManager);
+	setOccluder(backWallR);
 	root->add_child(backWallR);
 
 	SceneNode* backWallB = createNodeRotateMesh("same_side_cube", "backWallB",
 		glm::vec3(0.75, 0.5, -1), glm::vec3(3, 1, 0.2), 0);
 	setTexture(backWallB, "WallWood", textureManager);
+	setOccluder(backWallB);
 	root->add_child(backWallB);
 
 	SceneNode* windowLedge = createNodeRotateMesh("same_side_cube", "windowLedge",
@@ -185,21 +205,25 @@ SceneNode* Scene::generateRoomScene() {
 	SceneNode* backWallT = createNodeRotateMesh("same_side_cube", "backWallT",
 		glm::vec3(0, 1.151, 0), glm::vec3(3, 0.5, 0.2), 0);
 	setTexture(backWallT, "WallWood", textureManager);
+	setOccluder(backWallT);
 	window->add_child(backWallT);
 
 	SceneNode* frontWallL = createNodeRotateMesh("same_side_cube", "frontWallL",
 		glm::vec3(-1.5, 1.75, 5), glm::vec3(0.5, 3.5, 0.2), 0);
 	setTexture(frontWallL, "WallWood", textureManager);
+	setOccluder(frontWallL);
 	root->add_child(frontWallL);
 
 	SceneNode* frontWallR = createNodeRotateMesh("same_side_cube", "frontWallR",
 		glm::vec3(1.7, 1.75, 5), glm::vec3(2.2, 3.5, 0.2), 0);
 	setTexture(frontWallR, "WallWood", textureManager);
+	setOccluder(frontWallR);
 	root->add_child(frontWallR);
 
 	SceneNode* roof = createNodeRotateMesh("same_side_cube", "frontWallR",
 		glm::vec3(0.5, 3.5, 2), glm::vec3(5, 0.2, 6.5), 0);
 	setMaterial(roof, brown);
+	setOccluder(roof);
 	root->add_child(roof);
 
 	SceneNode* plat = createNodeRotateMesh("same_side_cube", "room plat",
@@ -207,7 +231,7 @@ SceneNode* Scene::generateRoomScene() {
 	setMaterial(plat, almostTransparent);
 	root->add_child(plat);
 
-	Lantern* lantern = new Lantern("roomlantern2", 5, batchInfoMap["mylantern"].aabb);
+	Lantern* lantern = new Lantern("roomlantern2", 5, batchInfoMap["lantern1"].aabb);
 	lantern->translate(glm::vec3(2, 0, 0));
 	root->add_child(lantern);
 	lanterns.push_back(lantern);
@@ -218,7 +242,7 @@ SceneNode* Scene::generateRoomScene() {
 SceneNode* Scene::generateRocksScene() {
 	SceneNode* root = new SceneNode("rocks_root");
 
-	Lantern* lantern = new Lantern("rocksLantern", 7, batchInfoMap["mylantern"].aabb);
+	Lantern* lantern = new Lantern("rocksLantern", 7, batchInfoMap["lantern1"].aabb);
 	lantern->translate(glm::vec3(0, 0.25, 0));
 	root->add_child(lantern);
 	lanterns.push_back(lantern);
@@ -353,6 +377,8 @@ void Scene::generateScene(
 
 	// TODO: have a function read from a file
     root = new SceneNode("root");
+	// every node added under the root is registered for id lookups
+	root->setRegistry(&registry);
 
 	// create the floor
     SceneNode* floorNode = createNodeRotateMesh("same_side_cube", "floor", 
@@ -383,16 +409,30 @@ void Scene::generateScene(
 	for (int i = 0; i < lanterns.size(); i++) {
 		pointLights.push_back(lanterns[i]->getLightSource());
 	}
+
+	// flatten the tree, then build the collision hierarchy once all the AABBs are in place
+	store.build(root, batchInfoMap);
+	bvh.build(root);
 }
 
 Player* Scene::getPlayer() { return player; }
 
 SceneNode* Scene::getRoot() { return root; }
 
+SceneStore& Scene::getStore() { return store; }
+
 std::vector<PointLight*> Scene::getPointLights() { return pointLights; }
 
 void Scene::updateGlobalPos() {
-    root->updateGlobalPos(glm::mat4(1));
+	// nothing moved since the last update
+	if (!root->needsUpdate()) { return; }
+	// nodes were added or removed, so the flattened layout is stale
+	if (store.needsRebuild()) {
+		store.build(root, batchInfoMap);
+		bvh.build(root);
+		return;
+	}
+	if (store.update()) { bvh.refit(); }
 }
 
 DirectionalLight Scene::getDirectionalLight() {
@@ -402,17 +442,92 @@ DirectionalLight Scene::getDirectionalLight() {
 std::vector<Lantern*> Scene::getLanterns() { return lanterns; }
 
 SceneNode* Scene::getNodeWithId(unsigned int id) {
-    if (root == nullptr) { return nullptr; }
-    return root -> getNodeWithId(id);
+    return registry.get(id);
 };
 
+NodeRegistry& Scene::getRegistry() { return registry; }
+
+void Scene::setRandomSeed(unsigned long long seed) {
+	randomSeed = seed;
+	tickCount = 0;
+}
+
+void Scene::setProjection(const glm::mat4& P) { emissionScheduler.setProjection(P); }
+
+const EmissionStats& Scene::getEmissionStats() { return emissionScheduler.getStats(); }
+
 void Scene::tick(float elapsedTime) {
     // tick each lantern
     for (int i=0; i<lanterns.size(); i++) {
-        lanterns[i] -> tick(elapsedTime, particleManager, player->getViewPos());
+        lanterns[i] -> tick(elapsedTime, player->getViewPos());
     }
+
+    // split the particle budget between the lanterns
+    emissionScheduler.schedule(lanterns, player->getViewPos(), player->getViewMatrix(),
+        particleManager->getNumParticles(), particleManager->getMaxParticles(), elapsedTime);
+
+    // lanterns emit in parallel. each one reseeds the generator of whichever thread runs it
+    // and fills its own batch, so the particles do not depend on how the jobs were split
+    unsigned long long tickSeed = mixSeed(randomSeed, tickCount++);
+    emitBatches.resize(lanterns.size());
+    jobSystem->parallelFor(lanterns.size(), LANTERNS_PER_JOB, [&](unsigned int begin, unsigned int end) {
+        for (unsigned int i = begin; i < end; i++) {
+            seedRandom(mixSeed(tickSeed, i));
+            emitBatches[i].clear();
+            lanterns[i]->emitParticles(emitBatches[i], emissionScheduler.getLod(i));
+        }
+    });
+    for (int i=0; i<emitBatches.size(); i++) {
+        particleManager->addParticles(emitBatches[i]);
+        emissionScheduler.recordEmission(i, emitBatches[i].size());
+    }
+    emissionScheduler.setDropped(particleManager->getNumDropped());
 }
 
 GeometryNode* Scene::checkIntersect(AABB& other) {
-	return root->checkIntersect(other);
+	return bvh.checkIntersect(other);
+}
+
+void Scene::getAllIntersections(AABB& other, std::vector<GeometryNode*>& result) {
+	bvh.getAllIntersections(other, result);
+}
+
+GeometryNode* Scene::rayCastExact(glm::vec3 origin, glm::vec3 dir, float maxDist) {
+	rayHits.clear();
+	bvh.getAllRayIntersections(origin, dir, maxDist, rayHits);
+	std::sort(rayHits.begin(), rayHits.end(), 
+		[](const RayHit& a, const RayHit& b) { return a.t < b.t; });
+
+	GeometryNode* closest = nullptr;
+	float best = maxDist;
+	for (const RayHit& hit : rayHits) {
+		// every remaining AABB starts further than the closest triangle
+		if (hit.t > best) { break; }
+		GeometryNode* node = hit.node;
+		auto batch = batchInfoMap.find(node->meshId);
+		if (batch == batchInfoMap.end()) { continue; }
+
+		// test in the mesh's space, t is unchanged since dir is not normalized
+		glm::mat4 inv = glm::inverse(node->getWorldTransform());
+		glm::vec3 localOrigin = glm::vec3(inv * glm::vec4(origin, 1));
+		glm::vec3 localDir = glm::vec3(inv * glm::vec4(dir, 0));
+
+		unsigned int start = batch->second.startIndex;
+		unsigned int end = std::min(start + batch->second.numIndices, (unsigned int)vertexPositions.size());
+		for (unsigned int i = start; i + 2 < end; i += 3) {
+			float t;
+			if (intersectRayTriangle(localOrigin, localDir, 
+				vertexPositions[i], vertexPositions[i + 1], vertexPositions[i + 2], t) && t < best) {
+				best = t;
+				closest = node;
+			}
+		}
+	}
+	return closest;
+}
+
+void Scene::initMeshData(const MeshConsolidator& meshConsolidator) {
+	const glm::vec3* positions = (const glm::vec3*)meshConsolidator.getVertexPositionDataPtr();
+	size_t numPositions = meshConsolidator.getNumVertexPositionBytes() / sizeof(glm::vec3);
+	vertexPositions.assign(positions, positions + numPositions);
 }
\ No newline at end of file
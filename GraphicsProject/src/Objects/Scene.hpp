@@ -4,6 +4,10 @@
 #include "LightSource.hpp"
 #include "Player.hpp"
 #include "Lantern.hpp"
+#include "BVH.hpp"
+#include "SceneStore.hpp"
+#include "NodeRegistry.hpp"
+#include "EmissionScheduler.hpp"
 #include "../TextureManager.hpp"
 #include "../Application/MeshConsolidator.hpp"
 
@@ -18,10 +22,22 @@ class Scene {
     std::vector<PointLight*> pointLights;
     std::vector<Lantern*> lanterns;
     ParticleShader* particleManager;
+	JobSystem* jobSystem;
+	// particle emission is repeatable for a given seed
+	unsigned long long randomSeed;
+	unsigned long long tickCount;
+	std::vector<std::vector<ParticleSpawn>> emitBatches;	// one per lantern
+	EmissionScheduler emissionScheduler;	// shares the particle pool between the lanterns
+	SceneStore store;					// flattened copy of the tree for fast traversal
+	BVH bvh;							// for collision queries
+	NodeRegistry registry;				// id lookup for picking
 
 	// for generating the scene
 	TextureManager* textureManager;
 	BatchInfoMap batchInfoMap;
+	// copy of the mesh vertices, for exact ray picking on the CPU
+	std::vector<glm::vec3> vertexPositions;
+	std::vector<RayHit> rayHits;
 	SceneNode* generateRoomScene();
 	SceneNode* generateShapeScene();
 	SceneNode* generateRocksScene();
@@ -31,19 +47,31 @@ class Scene {
 
 
     public:
-        Scene(ParticleShader* pm);
+        Scene(ParticleShader* pm, JobSystem* js);
         ~Scene();
         void generateScene(TextureManager* manager, BatchInfoMap& batchInfoMap, SoundManager* soundManager);
+		void initMeshData(const MeshConsolidator& meshConsolidator);
         
 		void updateGlobalPos();
 		void tick(float elapsedTime);
 		GeometryNode* checkIntersect(AABB& other);
+		// finds every node that intersects with the given AABB
+		void getAllIntersections(AABB& other, std::vector<GeometryNode*>& result);
+		// finds the first node whose mesh is hit by the ray, null if none within maxDist
+		GeometryNode* rayCastExact(glm::vec3 origin, glm::vec3 dir, float maxDist);
 
 		// GETTERS
 		SceneNode* getRoot();
+		SceneStore& getStore();
         Player* getPlayer();
         DirectionalLight getDirectionalLight();
         std::vector<PointLight*> getPointLights();
         std::vector<Lantern*> getLanterns();
+        // constant time, returns nullptr if the node is not in the scene
         SceneNode* getNodeWithId(unsigned int id);
+		NodeRegistry& getRegistry();
+		void setRandomSeed(unsigned long long seed);
+		// the emission scheduler needs it for frustum visibility and projected size
+		void setProjection(const glm::mat4& P);
+		const EmissionStats& getEmissionStats();
 };
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include "SceneNode.hpp"
 #include "GeometryNode.hpp"
+#include "SceneStore.hpp"
+#include "NodeRegistry.hpp"
 
 #include <iostream>
 #include <sstream>
@@ -19,7 +21,14 @@ SceneNode::SceneNode(const std::string& name)
   : m_name(name),
 	m_nodeType(NodeType::SceneNode),
 	trans(glm::mat4(1.0)),
-	m_nodeId(nodeInstanceCount++)
+	worldTrans(glm::mat4(1.0)),
+	m_nodeId(nodeInstanceCount++),
+	parent(nullptr),
+	store(nullptr),
+	storeIndex(-1),
+	registry(nullptr),
+	transformDirty(true),
+	childDirty(false)
 {
 
 }
@@ -30,7 +39,13 @@ SceneNode::SceneNode(const SceneNode & other)
 	: m_nodeType(other.m_nodeType),
 	  m_name(other.m_name),
 	  trans(other.trans),
-	  parent(nullptr)
+	  worldTrans(other.worldTrans),
+	  parent(nullptr),
+	  store(nullptr),
+	  storeIndex(-1),
+	  registry(nullptr),
+	  transformDirty(true),
+	  childDirty(false)
 {
 	for(SceneNode * child : other.children) {
 		this->children.push_front(new SceneNode(*child));
@@ -39,6 +54,12 @@ SceneNode::SceneNode(const SceneNode & other)
 
 //---------------------------------------------------------------------------------------
 SceneNode::~SceneNode() {
+	// let the store know this handle is gone
+	if (store != nullptr) {
+		store->nodes[storeIndex] = nullptr;
+		store->invalidate();
+	}
+	if (registry != nullptr) { registry->remove(this); }
 	for(SceneNode * child : children) {
 		delete child;
 	}
@@ -47,6 +68,7 @@ SceneNode::~SceneNode() {
 //---------------------------------------------------------------------------------------
 void SceneNode::set_transform(const glm::mat4& m) {
 	trans = m;
+	markDirty();
 }
 
 //---------------------------------------------------------------------------------------
@@ -56,14 +78,24 @@ const glm::mat4& SceneNode::get_transform() const {
 
 //---------------------------------------------------------------------------------------
 void SceneNode::add_child(SceneNode* child) {
-	if (child) { child->parent = this; }
+	if (child) { 
+		child->parent = this; 
+		// the child now sits under a different transform
+		child->markDirty();
+		child->setRegistry(registry);
+	}
 	children.push_back(child);
+	if (store != nullptr) { store->invalidate(); }
 }
 
 //---------------------------------------------------------------------------------------
 void SceneNode::remove_child(SceneNode* child) {
-	if (child) { child->parent = nullptr; }
+	if (child) { 
+		child->parent = nullptr; 
+		child->setRegistry(nullptr);
+	}
 	children.remove(child);
+	if (store != nullptr) { store->invalidate(); }
 }
 
 //---------------------------------------------------------------------------------------
@@ -85,16 +117,19 @@ void SceneNode::rotate(char axis, float angle) {
 	}
 	glm::mat4 rot_matrix = glm::rotate(degreesToRadians((float)angle), rot_axis);
 	trans = rot_matrix * trans;
+	markDirty();
 }
 
 //---------------------------------------------------------------------------------------
 void SceneNode::scale(const glm::vec3 & amount) {
 	trans = glm::scale(amount) * trans;
+	markDirty();
 }
 
 //---------------------------------------------------------------------------------------
 void SceneNode::translate(const glm::vec3& amount) {
 	trans = glm::translate(amount) * trans;
+	markDirty();
 }
 
 
@@ -103,14 +138,48 @@ int SceneNode::totalSceneNodes() const {
 	return nodeInstanceCount;
 }
 
-void SceneNode::updateGlobalPos(glm::mat4 curM) {
-	glm::mat4 fullT = curM*trans;
-	globalPos = glm::vec3(fullT[3]);
-	for(SceneNode * child : children) {
-		child -> updateGlobalPos(fullT);
+//---------------------------------------------------------------------------------------
+// flag this node, and let every ancestor know there is work to do below them
+void SceneNode::markDirty() {
+	if (store != nullptr) {
+		store->markDirty(storeIndex, trans);
+		return;
+	}
+	transformDirty = true;
+	for (SceneNode* p = parent; p != nullptr && !p->childDirty; p = p->parent) {
+		p->childDirty = true;
+	}
+}
+
+bool SceneNode::needsUpdate() const {
+	if (store != nullptr) { return store->needsUpdate(); }
+	return transformDirty || childDirty;
+}
+
+void SceneNode::updateGlobalPos(const glm::mat4& parentM, bool parentMoved) {
+	// flattened nodes are all updated at once by the store
+	if (store != nullptr) {
+		store->update();
+		return;
+	}
+	bool moved = parentMoved || transformDirty;
+	if (moved) {
+		worldTrans = parentM*trans;
+		globalPos = glm::vec3(worldTrans[3]);
+		onWorldTransformChanged();
+	}
+	// clean subtrees that did not move can be skipped entirely
+	if (moved || childDirty) {
+		for (SceneNode * child : children) {
+			child -> updateGlobalPos(worldTrans, moved);
+		}
 	}
+	transformDirty = false;
+	childDirty = false;
 }
 
+void SceneNode::onWorldTransformChanged() {}
+
 GeometryNode* SceneNode::checkIntersect(AABB& other) {
 	for (SceneNode * child : children) {
 		GeometryNode* possible = child->checkIntersect(other);
@@ -119,7 +188,25 @@ GeometryNode* SceneNode::checkIntersect(AABB& other) {
 	return nullptr;
 }
 
-glm::vec3 SceneNode::getGlobalPos() { return globalPos; }
+glm::vec3 SceneNode::getGlobalPos() { 
+	if (store != nullptr) { return glm::vec3(store->worldTrans[storeIndex][3]); }
+	return globalPos; 
+}
+
+const glm::mat4& SceneNode::getWorldTransform() const { 
+	if (store != nullptr) { return store->worldTrans[storeIndex]; }
+	return worldTrans; 
+}
+
+void SceneNode::setRegistry(NodeRegistry* r) {
+	if (registry == r) { return; }
+	if (registry != nullptr) { registry->remove(this); }
+	registry = r;
+	if (registry != nullptr) { registry->add(this); }
+	for (SceneNode* child : children) {
+		child->setRegistry(r);
+	}
+}
 
 SceneNode* SceneNode::getNodeWithId(unsigned int id) {
 	if (m_nodeId == id) { return this; }
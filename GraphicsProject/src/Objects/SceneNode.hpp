@@ -18,6 +18,8 @@ enum class NodeType {
 };
 
 class GeometryNode;
+class SceneStore;
+class NodeRegistry;
 
 class SceneNode {
 public:
@@ -29,7 +31,6 @@ public:
 	std::string m_name;
 	unsigned int m_nodeId;
 	glm::mat4 trans;
-	glm::vec3 globalPos;
 
 	// methods
     SceneNode(const std::string & name);
@@ -50,13 +51,42 @@ public:
 
 	friend std::ostream & operator << (std::ostream & os, const SceneNode & node);
 
-    virtual void updateGlobalPos(glm::mat4 curM);
+	// recomputes the world transforms of dirty subtrees only
+    void updateGlobalPos(const glm::mat4& parentM, bool parentMoved);
     glm::vec3 getGlobalPos();
+	const glm::mat4& getWorldTransform() const;
+	// true iff this node or any descendant needs its world transform updated
+	bool needsUpdate() const;
 	// recursively checks if any node intersects with the given AABB
 	virtual GeometryNode* checkIntersect(AABB& other);
-	// recursively finds node with id
+	// recursively finds node with id, prefer NodeRegistry::get when in a scene
     SceneNode* getNodeWithId(unsigned int id);
+	// registers this subtree with the given registry, unregistering it from the old one
+	void setRegistry(NodeRegistry* r);
+	friend class SceneStore;
+	friend class NodeRegistry;
+
+protected:
+	// only used while the node is not part of a SceneStore,
+	// otherwise the store holds the world data
+	glm::mat4 worldTrans;			// cached product of every transform from the root
+	glm::vec3 globalPos;
+
+	// the store this node is a handle into, null if not flattened yet
+	SceneStore* store;
+	int storeIndex;
+
+	// the registry of the tree this node is in, if any
+	NodeRegistry* registry;
+
+	// called after the world transform of this node changes
+	virtual void onWorldTransformChanged();
+
 private:
+	bool transformDirty;			// local transform changed since the last update
+	bool childDirty;				// some descendant has a dirty transform
+	void markDirty();
+
 	// The number of SceneNode instances.
 	static unsigned int nodeInstanceCount;
 };
@@ -0,0 +1,156 @@
+#include "SceneStore.hpp"
+
+#include <algorithm>
+
+SceneStore::SceneStore() : structureChanged(false), firstDirty(0), dirtyEnd(0) {}
+
+SceneStore::~SceneStore() {
+	detachAll();
+}
+
+// hand the latest world data back to the nodes so they stay valid on their own
+void SceneStore::detachAll() {
+	for (int i = 0; i < nodes.size(); i++) {
+		SceneNode* node = nodes[i];
+		// deleted since the last build
+		if (node == nullptr) { continue; }
+		node->store = nullptr;
+		node->storeIndex = -1;
+		node->transformDirty = true;
+		node->trans = localTrans[i];
+		node->worldTrans = worldTrans[i];
+		node->globalPos = glm::vec3(worldTrans[i][3]);
+		if (isGeometry(i)) {
+			static_cast<GeometryNode*>(node)->transformedAABB = worldAABBs[i];
+		}
+	}
+	nodes.clear();
+	parents.clear();
+	subtreeEnds.clear();
+	localTrans.clear();
+	worldTrans.clear();
+	dirty.clear();
+	baseAABBs.clear();
+	worldAABBs.clear();
+	materialHandles.clear();
+	batches.clear();
+	geometryIndices.clear();
+	occluderIndices.clear();
+	subtreeAABBs.clear();
+	subtreeGeometryCounts.clear();
+	materials.clear();
+}
+
+int SceneStore::getMaterialHandle(GeometryNode* node) {
+	for (int i = 0; i < materials.size(); i++) {
+		MaterialEntry& entry = materials[i];
+		if (entry.materialType != node->materialType) { continue; }
+		if (node->materialType == MaterialType::Texture) {
+			if (entry.textureId == node->textureId) { return i; }
+		}
+		else if (entry.material.kd == node->material.kd && entry.material.ks == node->material.ks
+			&& entry.material.shininess == node->material.shininess) {
+			return i;
+		}
+	}
+	materials.push_back({ node->materialType, node->material, node->textureId });
+	return materials.size() - 1;
+}
+
+void SceneStore::flatten(SceneNode* node, int parent, BatchInfoMap& batchInfoMap) {
+	if (node == nullptr) { return; }
+	int index = nodes.size();
+	node->store = this;
+	node->storeIndex = index;
+	node->transformDirty = false;
+	node->childDirty = false;
+
+	nodes.push_back(node);
+	parents.push_back(parent);
+	subtreeEnds.push_back(index + 1);
+	localTrans.push_back(node->trans);
+	worldTrans.push_back(glm::mat4(1));
+	dirty.push_back(1);
+	if (node->m_nodeType == NodeType::GeometryNode) {
+		GeometryNode* geometryNode = static_cast<GeometryNode*>(node);
+		baseAABBs.push_back(geometryNode->baseAABB);
+		materialHandles.push_back(getMaterialHandle(geometryNode));
+		batches.push_back(batchInfoMap[geometryNode->meshId]);
+		geometryIndices.push_back(index);
+		if (geometryNode->isOccluder) { occluderIndices.push_back(index); }
+	} else {
+		baseAABBs.push_back(AABB());
+		materialHandles.push_back(-1);
+		batches.push_back(BatchInfo());
+	}
+	worldAABBs.push_back(baseAABBs.back());
+	subtreeAABBs.push_back(baseAABBs.back());
+	subtreeGeometryCounts.push_back(0);
+
+	int geometryBefore = geometryIndices.size() - (isGeometry(index) ? 1 : 0);
+	for (SceneNode* child : node->children) {
+		flatten(child, index, batchInfoMap);
+	}
+	subtreeEnds[index] = nodes.size();
+	subtreeGeometryCounts[index] = geometryIndices.size() - geometryBefore;
+}
+
+void SceneStore::build(SceneNode* root, BatchInfoMap& batchInfoMap) {
+	detachAll();
+	flatten(root, -1, batchInfoMap);
+	moved.assign(nodes.size(), 0);
+	structureChanged = false;
+	// everything starts dirty
+	firstDirty = 0;
+	dirtyEnd = nodes.size();
+	update();
+}
+
+bool SceneStore::update() {
+	if (firstDirty >= dirtyEnd) { return false; }
+	// parents come before children, so one forward sweep over the dirty range is enough
+	for (int i = firstDirty; i < dirtyEnd; i++) {
+		int p = parents[i];
+		bool m = dirty[i] || (p >= 0 && moved[p]);
+		moved[i] = m;
+		if (!m) { continue; }
+		worldTrans[i] = p >= 0 ? worldTrans[p] * localTrans[i] : localTrans[i];
+		if (isGeometry(i)) { worldAABBs[i] = baseAABBs[i].transform(worldTrans[i]); }
+		dirty[i] = 0;
+	}
+
+	// children come after parents, so sweep backwards to refresh the subtree bounds.
+	// only the moved range and the ancestors around it can have changed
+	for (int i = dirtyEnd - 1; i >= 0; i--) {
+		if (subtreeEnds[i] <= firstDirty || subtreeGeometryCounts[i] == 0) { continue; }
+		bool empty = !isGeometry(i);
+		AABB box = worldAABBs[i];
+		for (int c = i + 1; c < subtreeEnds[i]; c = subtreeEnds[c]) {
+			if (subtreeGeometryCounts[c] == 0) { continue; }
+			box = empty ? subtreeAABBs[c] : box.merge(subtreeAABBs[c]);
+			empty = false;
+		}
+		subtreeAABBs[i] = box;
+	}
+	std::fill(moved.begin() + firstDirty, moved.begin() + dirtyEnd, 0);
+	firstDirty = nodes.size();
+	dirtyEnd = 0;
+	return true;
+}
+
+void SceneStore::markDirty(int index, const glm::mat4& trans) {
+	localTrans[index] = trans;
+	dirty[index] = 1;
+	firstDirty = std::min(firstDirty, index);
+	dirtyEnd = std::max(dirtyEnd, subtreeEnds[index]);
+}
+
+void SceneStore::invalidate() { structureChanged = true; }
+
+bool SceneStore::needsUpdate() const { return structureChanged || firstDirty < dirtyEnd; }
+
+bool SceneStore::needsRebuild() const { return structureChanged; }
+
+int SceneStore::size() const { return nodes.size(); }
+
+bool SceneStore::isGeometry(int index) const { return materialHandles[index] >= 0; }
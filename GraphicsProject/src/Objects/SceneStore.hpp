@@ -0,0 +1,76 @@
+#pragma once
+
+#include "SceneNode.hpp"
+#include "GeometryNode.hpp"
+#include "Material.hpp"
+#include "../Application/AABB.hpp"
+#include "../Application/MeshConsolidator.hpp"
+
+#include <glm/glm.hpp>
+#include <vector>
+
+// everything needed to colour a geometry node, shared between nodes that look the same
+struct MaterialEntry {
+	MaterialType materialType;
+	Material material;
+	GLuint textureId;
+};
+
+// Flattened copy of a scene tree. Nodes are stored contiguously in depth first order,
+// so a parent always comes before its children, and each attribute lives in its own
+// array so that a traversal only touches the data it needs. Once built, the
+// SceneNodes in the tree act as handles into the store.
+class SceneStore {
+	bool structureChanged;				// tree was edited, must rebuild before use
+	int firstDirty;						// range of nodes that need their world transform updated
+	int dirtyEnd;
+	std::vector<unsigned char> moved;	// scratch space for update()
+
+	// helpers
+	void flatten(SceneNode* node, int parent, BatchInfoMap& batchInfoMap);
+	int getMaterialHandle(GeometryNode* node);
+	void detachAll();
+
+	public:
+		// per node attributes, indexed by depth first order
+		std::vector<SceneNode*> nodes;
+		std::vector<int> parents;				// -1 for the root
+		std::vector<int> subtreeEnds;			// one past the last descendant
+		std::vector<glm::mat4> localTrans;
+		std::vector<glm::mat4> worldTrans;
+		std::vector<unsigned char> dirty;		// local transform changed
+
+		// geometry attributes, only meaningful for geometry nodes
+		std::vector<AABB> baseAABBs;
+		std::vector<AABB> worldAABBs;
+		std::vector<int> materialHandles;		// -1 if not a geometry node
+		std::vector<BatchInfo> batches;
+		std::vector<int> geometryIndices;		// every geometry node, in depth first order
+		std::vector<int> occluderIndices;		// geometry nodes that are solid boxes
+
+		// bounds of all the geometry under each node, including itself, for culling whole subtrees.
+		// meaningless when the subtree has no geometry
+		std::vector<AABB> subtreeAABBs;
+		std::vector<int> subtreeGeometryCounts;
+
+		// deduplicated table indexed by the material handles
+		std::vector<MaterialEntry> materials;
+
+		SceneStore();
+		~SceneStore();
+
+		// flattens the tree, computing every world transform from scratch
+		void build(SceneNode* root, BatchInfoMap& batchInfoMap);
+		// recomputes the world transform of dirty subtrees, and the subtree bounds around them.
+		// returns true iff any node moved
+		bool update();
+
+		// called by the SceneNode handles
+		void markDirty(int index, const glm::mat4& trans);
+		void invalidate();
+
+		bool needsUpdate() const;
+		bool needsRebuild() const;
+		int size() const;
+		bool isGeometry(int index) const;
+};
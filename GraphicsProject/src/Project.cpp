@@ -3,6 +3,7 @@
 #include "Application/MathUtils.hpp"
 #include "Application/GlErrorCheck.hpp"
 #include "Objects/Lantern.hpp"
+#include "Application/OcclusionCuller.hpp"
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/io.hpp>
@@ -17,20 +18,38 @@ using namespace glm;
 // fix game ticks per second
 const float TICKS_PER_SECOND = 60;
 const float cycleRate = 1/TICKS_PER_SECOND;
-
-Project::Project():
+// how far the crosshair can reach when picking on the CPU
+const float MAX_PICK_DISTANCE = 100;
+// sizes of the light and lantern arrays in the shaders,
+// both blocks stay under the 16KB uniform block size every GL 3.3 driver allows
+const int MAX_POINT_LIGHTS = 256;
+const int MAX_LANTERNS = 256;
+// where the profiler writes its chrome://tracing file
+const std::string TRACE_FILE = "profile_trace.json";
+
+Project::Project(RenderPath path):
+	renderPath(path),
     primary_shader(nullptr), 
     picking_shader(nullptr),
 	shape_shader(nullptr),
+	scene_uniforms(nullptr),
+	transparency_pass(nullptr),
+	occlusion_culler(nullptr),
     particle_shader(nullptr),
     text_shader(nullptr),
     shadow_shader(nullptr),
+	depth_prepass_shader(nullptr),
+	gbuffer_shader(nullptr),
+	deferred_lighting_pass(nullptr),
+	lantern_filter_pass(nullptr),
     skybox_shader(nullptr),
 	sprite_shader(nullptr),
 	hud(nullptr),
 	flameManager(nullptr),
 	soundManager(nullptr),
-	textureManager(nullptr) {}
+	selectedObj(NULL_NODE_HANDLE),
+	textureManager(nullptr),
+	job_system(nullptr) {}
 
 Project::~Project() {
 	// CR-someday: getting a malformed heap exception when deleting primary shader
@@ -39,15 +58,23 @@ Project::~Project() {
 	if (primary_shader != nullptr) { delete primary_shader; } 
     if (picking_shader != nullptr) { delete picking_shader; }
 	if (shape_shader != nullptr) { delete shape_shader;  }
+	if (scene_uniforms != nullptr) { delete scene_uniforms; }
+	if (transparency_pass != nullptr) { delete transparency_pass; }
+	if (occlusion_culler != nullptr) { delete occlusion_culler; }
     if (particle_shader != nullptr) { delete particle_shader; } 
     if (text_shader != nullptr) { delete text_shader; } 
     if (shadow_shader != nullptr) { delete shadow_shader; } 
+	if (depth_prepass_shader != nullptr) { delete depth_prepass_shader; }
+	if (gbuffer_shader != nullptr) { delete gbuffer_shader; }
+	if (deferred_lighting_pass != nullptr) { delete deferred_lighting_pass; }
+	if (lantern_filter_pass != nullptr) { delete lantern_filter_pass; }
     if (skybox_shader != nullptr) { delete skybox_shader; } 
 	if (sprite_shader != nullptr) { delete sprite_shader; }
 	if (hud != nullptr) { delete hud; }
 	if (flameManager != nullptr) { delete flameManager; } 
     if (soundManager != nullptr) { delete soundManager; }
 	if (textureManager != nullptr) { delete textureManager;  }
+	if (job_system != nullptr) { delete job_system; }
 }
 
 //----------------------------------------------
@@ -87,34 +114,79 @@ void Project::init() {
 	sprite_shader->initData();
 	shape_shader = new ShapeShader(m_windowHeight, m_windowWidth);
 	shape_shader->initData();
-	hud = new HUD(m_windowHeight, m_windowWidth, text_shader, shape_shader, sprite_shader);
+	hud = new HUD(m_windowHeight, m_windowWidth, text_shader, shape_shader, sprite_shader, &m_profiler);
+
+    // uniform blocks shared by the scene shaders
+	scene_uniforms = new SceneUniforms(MAX_POINT_LIGHTS, MAX_LANTERNS);
+	scene_uniforms->initData();
 
     // init shaders and load meshes to shaders
 	shouldDrawShadows = true;
 	transparencyEnabled = true;
+	cpuPickingEnabled = false;
+	depthPrepassEnabled = true;
 	shadow_shader = new ShadowShader(&m_batchInfoMap, m_windowWidth, m_windowHeight, shouldDrawShadows, transparencyEnabled);
     shadow_shader -> initMeshData(meshConsolidator);
     
-    primary_shader = new ClassicShader(&m_batchInfoMap, shadow_shader, true, transparencyEnabled);
+    primary_shader = new ClassicShader(&m_batchInfoMap, shadow_shader, scene_uniforms, true, transparencyEnabled);
     primary_shader -> initMeshData(meshConsolidator);
     primary_shader -> loadUniforms(m_perpsective, shouldDrawShadows);
+	primary_shader->setDepthPrepassEnabled(depthPrepassEnabled);
+
+	depth_prepass_shader = new DepthPrepassShader(&m_batchInfoMap, transparencyEnabled);
+	depth_prepass_shader->initMeshData(meshConsolidator);
+	depth_prepass_shader->loadUniforms(m_perpsective);
+
+	// the deferred passes are only made when asked for, and the forward path is
+	// used if the G-buffer or the lighting targets can not be created
+	if (renderPath == RenderPath::Deferred) {
+		gbuffer_shader = new GBufferShader(&m_batchInfoMap, scene_uniforms, m_framebufferWidth, m_framebufferHeight,
+			true, transparencyEnabled);
+		gbuffer_shader->initMeshData(meshConsolidator);
+		gbuffer_shader->loadUniforms(m_perpsective);
+		deferred_lighting_pass = new DeferredLightingPass(gbuffer_shader, shadow_shader, scene_uniforms,
+			m_framebufferWidth, m_framebufferHeight, shouldDrawShadows);
+		deferred_lighting_pass->initData();
+		lantern_filter_pass = new LanternFilterPass(gbuffer_shader, deferred_lighting_pass, scene_uniforms);
+		lantern_filter_pass->initData();
+		if (!gbuffer_shader->getIsSupported() || !deferred_lighting_pass->getIsSupported()) {
+			renderPath = RenderPath::Forward;
+		}
+	}
+	// the main pass only draws the translucent objects when the opaque ones are deferred
+	primary_shader->setOpaqueDeferred(renderPath == RenderPath::Deferred);
 
     quad_shader = new QuadShader(shadow_shader);
     
-    picking_shader = new PickingShader(&m_batchInfoMap);
+    picking_shader = new PickingShader(&m_batchInfoMap, m_windowWidth, m_windowHeight);
     picking_shader -> initMeshData(meshConsolidator);
     picking_shader -> loadUniforms(m_perpsective);
 
-    particle_shader = new ParticleShader(10000);
+	// both passes draw from the player's camera, so they can share the occlusion results
+	occlusion_culler = new OcclusionCuller();
+	primary_shader->setOcclusionCuller(occlusion_culler);
+	depth_prepass_shader->setOcclusionCuller(occlusion_culler);
+	if (gbuffer_shader != nullptr) { gbuffer_shader->setOcclusionCuller(occlusion_culler); }
+	picking_shader->setOcclusionCuller(occlusion_culler);
+
+	job_system = new JobSystem();
+    particle_shader = new ParticleShader(10000, job_system);
     particle_shader -> initData();
-    particle_shader -> loadUniforms(m_perpsective);
 
     skybox_shader = new SkyboxShader("Skybox/mountain", "png");
     skybox_shader -> loadUniforms(m_perpsective);
 
+	// sort translucent things only if the accumulation targets are not available
+	transparency_pass = new TransparencyPass(m_framebufferWidth, m_framebufferHeight);
+	transparency_pass -> initData();
+	setTransparencyMode(transparency_pass->getIsSupported() ?
+		TransparencyMode::WeightedBlended : TransparencyMode::Sorted);
+
     // update scene & player
-    scene = new Scene(particle_shader);
+    scene = new Scene(particle_shader, job_system);
     scene -> generateScene(textureManager, m_batchInfoMap, soundManager);
+    scene -> setProjection(m_perpsective);
+    scene -> initMeshData(meshConsolidator);
     player = scene -> getPlayer();
 
     // set key bindings
@@ -135,6 +207,14 @@ void Project::init() {
 	keyToggleTransparency = GLFW_KEY_0;
 	keyToggleSound = GLFW_KEY_6;
 	keyTogglePlayerMode = GLFW_KEY_2;
+	keyTogglePicking = GLFW_KEY_P;
+	keyToggleParticleSort = GLFW_KEY_O;
+	keyToggleParticleBackend = GLFW_KEY_G;
+	keyToggleTransparencyMode = GLFW_KEY_I;
+	keyToggleProfiler = GLFW_KEY_F1;
+	keySaveTrace = GLFW_KEY_F2;
+	keyToggleOcclusionCulling = GLFW_KEY_C;
+	keyToggleDepthPrepass = GLFW_KEY_Z;
 	keyJump = GLFW_KEY_SPACE;
 
     glEnable(GL_DEPTH_TEST);
@@ -152,8 +232,14 @@ void Project::appLogic(float elapsedTime){
 		float deltaT = std::min((float)elapsedTime, (float)cycleRate);
 
 		// tick everything first
-		scene->tick(deltaT);
-		particle_shader->tick(deltaT);
+		{
+			ProfileScope scope(m_profiler, "scene tick");
+			scene->tick(deltaT);
+		}
+		{
+			ProfileScope scope(m_profiler, "particle tick");
+			particle_shader->tick(deltaT);
+		}
 		hud->tick(deltaT);
 		player->tick(deltaT);
 
@@ -165,8 +251,17 @@ void Project::appLogic(float elapsedTime){
 		elapsedTime -= cycleRate;
 	}
 	
+	// draw the occluders once the scene has stopped moving, for picking and drawing
+	{
+		ProfileScope scope(m_profiler, "occlusion");
+		occlusion_culler->update(scene->getStore(), player->getViewMatrix(), m_perpsective, player->getViewPos());
+	}
+
 	// then update picking
-	pick();
+	{
+		ProfileScope scope(m_profiler, "pick", true);
+		pick();
+	}
 }
 
 //----------------------------------------------
@@ -176,17 +271,78 @@ void Project::guiLogic() {}
 void Project::draw(){
     glm::mat4 V = player->getViewMatrix();
     glm::vec3 viewPos = player->getViewPos();
+
+	// one update of the shared blocks for the whole frame
+	scene_uniforms->updateCamera(V, m_perpsective, viewPos);
+	scene_uniforms->updateLights(scene, shadow_shader, viewPos);
    
 	// generate shadow map first
-    shadow_shader -> drawScene(scene, viewPos);
+	{
+		ProfileScope scope(m_profiler, "shadows", true);
+		shadow_shader -> drawScene(scene, viewPos);
+	}
 
-	// draw the scene
-	skybox_shader->draw(V, viewPos);
-	primary_shader -> drawScene(scene, V, viewPos);
-    particle_shader -> drawScene(V, viewPos);
+	if (renderPath == RenderPath::Deferred) {
+		// the opaque objects are written to the G-buffer, then lit and filtered once per pixel
+		{
+			ProfileScope scope(m_profiler, "gbuffer", true);
+			gbuffer_shader -> drawScene(scene, V, viewPos);
+		}
+		{
+			ProfileScope scope(m_profiler, "lighting", true);
+			deferred_lighting_pass -> draw();
+		}
+		{
+			ProfileScope scope(m_profiler, "lantern filters", true);
+			skybox_shader->draw(V, viewPos);
+			lantern_filter_pass -> draw();
+		}
+	}
+	// depth of the opaque objects, so the scene pass only shades what is visible
+	else if (depthPrepassEnabled) {
+		ProfileScope scope(m_profiler, "depth prepass", true);
+		depth_prepass_shader -> drawScene(scene, V, viewPos);
+	}
+
+	// draw the scene, only the translucent objects are left when deferred
+	{
+		ProfileScope scope(m_profiler, "scene", true);
+		if (renderPath == RenderPath::Forward) { skybox_shader->draw(V, viewPos); }
+		primary_shader -> drawScene(scene, V, viewPos);
+	}
+	{
+		ProfileScope scope(m_profiler, "translucent", true);
+		if (transparencyMode == TransparencyMode::WeightedBlended) {
+			// translucent objects and particles in any order, then blended over the opaque scene
+			transparency_pass -> begin();
+			primary_shader -> drawTransparent();
+			particle_shader -> drawScene(viewPos);
+			transparency_pass -> composite();
+		}
+		else {
+			particle_shader -> drawScene(viewPos);
+		}
+	}
 
     // then draw the hud
-    hud->draw(selectedObj, selectedFlame);
+	{
+		ProfileScope scope(m_profiler, "hud", true);
+		hud->draw(getSelectedObj(), selectedFlame);
+	}
+
+	// how much each pass culled
+	m_profiler.setCounter("shadow drawn", shadow_shader->getCullStats().visible);
+	m_profiler.setCounter("shadow culled", shadow_shader->getCullStats().culled);
+	if (renderPath == RenderPath::Deferred) {
+		m_profiler.setCounter("gbuffer drawn", gbuffer_shader->getCullStats().visible);
+		m_profiler.setCounter("gbuffer occluded", gbuffer_shader->getCullStats().occluded);
+	}
+	m_profiler.setCounter("scene drawn", primary_shader->getCullStats().visible);
+	m_profiler.setCounter("scene culled", primary_shader->getCullStats().culled);
+	m_profiler.setCounter("scene occluded", primary_shader->getCullStats().occluded);
+	m_profiler.setCounter("pick drawn", picking_shader->getCullStats().visible);
+	m_profiler.setCounter("pick culled", picking_shader->getCullStats().culled);
+	m_profiler.setCounter("pick occluded", picking_shader->getCullStats().occluded);
 	
 	// for debugging
 	// quad_shader -> draw();
@@ -255,32 +411,46 @@ bool Project::mouseMoveEvent (
 }
 
 void Project::pick() {
-	glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+	// cast a ray against the meshes instead, this skips the picking draw entirely.
+	// also used when there is no pick framebuffer
+	if (cpuPickingEnabled || !picking_shader->getIsSupported()) {
+		setSelectedObj(scene->rayCastExact(player->getViewPos(), player->getViewDirection(), MAX_PICK_DISTANCE));
+		return;
+	}
 
-    // draw the scene using the picking shader
+    // draw the pixels under the crosshair using the picking shader.
+	// the read back is asynchronous, so the result arrives a frame or two later
     glm::mat4 V = player->getViewMatrix();
-    picking_shader->drawScene(scene, V, player->getViewPos());
-
-	// A bit ugly -- don't want to swap the just-drawn false colours
-	// to the screen, so read from the back buffer.
-	glReadBuffer( GL_BACK );
-
-	// read pixel in the center of the screen
-	double centerX = m_windowWidth * 0.5;
-	double centerY = m_windowHeight * 0.5;
-	GLubyte buffer[4] = { 0, 0, 0, 0 };
-	glReadPixels( int(centerX), int(centerY), 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, buffer );
-	CHECK_GL_ERRORS;
+    picking_shader->requestPick(scene, V, player->getViewPos());
+
+	// keep the previous selection until a new result arrives
+	unsigned int id;
+	if (!picking_shader->pollPickResult(id)) { return; }
     
 	// find the geometry node whos id matches the pixel colour we extracted
-    unsigned int id = picking_shader->colourToId(buffer);
     SceneNode* lookingAt = scene -> getNodeWithId(id);
     if (lookingAt == nullptr || lookingAt -> m_nodeType != NodeType::GeometryNode) {
-        selectedObj = nullptr;
+        setSelectedObj(nullptr);
         return;
     }
     GeometryNode* geometryNode = static_cast<GeometryNode *>(lookingAt);
-    selectedObj = geometryNode;
+    setSelectedObj(geometryNode);
+}
+
+GeometryNode* Project::getSelectedObj() {
+	SceneNode* node = scene->getRegistry().get(selectedObj);
+	if (node == nullptr || node->m_nodeType != NodeType::GeometryNode) { return nullptr; }
+	return static_cast<GeometryNode*>(node);
+}
+
+void Project::setSelectedObj(GeometryNode* node) {
+	selectedObj = node != nullptr ? scene->getRegistry().getHandle(node) : NULL_NODE_HANDLE;
+}
+
+void Project::setTransparencyMode(TransparencyMode mode) {
+	transparencyMode = mode;
+	primary_shader->setTransparencyMode(mode);
+	particle_shader->setTransparencyMode(mode);
 }
 
 bool Project::mouseButtonInputEvent(int button, int actions, int mods) {
@@ -288,9 +458,10 @@ bool Project::mouseButtonInputEvent(int button, int actions, int mods) {
     if (actions == GLFW_PRESS) {
         if (button == GLFW_MOUSE_BUTTON_LEFT) {
             // try toggling a lantern
-            if (selectedObj != nullptr && 
-                selectedObj -> getObjectType() == ObjectType::Lantern) {
-                Lantern* lantern = static_cast<Lantern*>(selectedObj);
+            GeometryNode* selected = getSelectedObj();
+            if (selected != nullptr && 
+                selected -> getObjectType() == ObjectType::Lantern) {
+                Lantern* lantern = static_cast<Lantern*>(selected);
                 if (lantern -> getIsActivated()) {
                     lantern -> extinguish(soundManager);
                 } else {
@@ -352,6 +523,7 @@ bool Project::keyInputEvent (int key, int action, int mods) {
 			shouldDrawShadows = !shouldDrawShadows;
 			primary_shader->setShadowsEnabled(shouldDrawShadows);
 			shadow_shader->setIsEnabled(shouldDrawShadows);
+			if (deferred_lighting_pass != nullptr) { deferred_lighting_pass->setShadowsEnabled(shouldDrawShadows); }
 			return true;
 		}
 		if (key == keyToggleTextures) {
@@ -363,6 +535,7 @@ bool Project::keyInputEvent (int key, int action, int mods) {
 				hud->displayMessage("Textures Enabled");
 				primary_shader->setTexturesEnabled(true);
 			}
+			if (gbuffer_shader != nullptr) { gbuffer_shader->setTexturesEnabled(primary_shader->getTexturesEnabled()); }
 			return true; 
 		}
 		if (key == keyToggleTransparency) {
@@ -374,7 +547,9 @@ bool Project::keyInputEvent (int key, int action, int mods) {
 			}				
 			transparencyEnabled = !transparencyEnabled;
 			shadow_shader->setTransparencyEnabled(transparencyEnabled);
+			depth_prepass_shader->setTransparencyEnabled(transparencyEnabled);
 			primary_shader->setTransparencyEnabled(transparencyEnabled);
+			if (gbuffer_shader != nullptr) { gbuffer_shader->setTransparencyEnabled(transparencyEnabled); }
 			return true;
 		}
 		if (key == keyToggleSound) {
@@ -388,6 +563,84 @@ bool Project::keyInputEvent (int key, int action, int mods) {
 			}
 			return true;
 		}
+		if (key == keyTogglePicking) {
+			if (cpuPickingEnabled) {
+				hud->displayMessage("Picking: GPU");
+			}
+			else {
+				hud->displayMessage("Picking: CPU");
+			}
+			cpuPickingEnabled = !cpuPickingEnabled;
+			return true;
+		}
+		if (key == keyToggleParticleSort) {
+			if (particle_shader->getSortMode() == ParticleSortMode::Radix) {
+				hud->displayMessage("Particle Sort: Incremental");
+				particle_shader->setSortMode(ParticleSortMode::Incremental);
+			}
+			else {
+				hud->displayMessage("Particle Sort: Radix");
+				particle_shader->setSortMode(ParticleSortMode::Radix);
+			}
+			return true;
+		}
+		if (key == keyToggleParticleBackend) {
+			if (particle_shader->getBackend() == ParticleBackend::Cpu) {
+				hud->displayMessage("Particles: GPU");
+				particle_shader->setBackend(ParticleBackend::TransformFeedback);
+			}
+			else {
+				hud->displayMessage("Particles: CPU");
+				particle_shader->setBackend(ParticleBackend::Cpu);
+			}
+			return true;
+		}
+		if (key == keyToggleTransparencyMode) {
+			if (transparencyMode == TransparencyMode::WeightedBlended) {
+				hud->displayMessage("Transparency: Sorted");
+				setTransparencyMode(TransparencyMode::Sorted);
+			}
+			else if (transparency_pass->getIsSupported()) {
+				hud->displayMessage("Transparency: Weighted Blended");
+				setTransparencyMode(TransparencyMode::WeightedBlended);
+			}
+			return true;
+		}
+		if (key == keyToggleProfiler) {
+			hud->setShouldDrawProfiler(!hud->getShouldDrawProfiler());
+			return true;
+		}
+		if (key == keySaveTrace) {
+			if (m_profiler.writeChromeTrace(TRACE_FILE)) {
+				hud->displayMessage("Trace saved to " + TRACE_FILE);
+			}
+			else {
+				hud->displayMessage("Could not save the trace");
+			}
+			return true;
+		}
+		if (key == keyToggleOcclusionCulling) {
+			if (occlusion_culler->getIsEnabled()) {
+				hud->displayMessage("Occlusion Culling Disabled");
+				occlusion_culler->setIsEnabled(false);
+			}
+			else {
+				hud->displayMessage("Occlusion Culling Enabled");
+				occlusion_culler->setIsEnabled(true);
+			}
+			return true;
+		}
+		if (key == keyToggleDepthPrepass) {
+			if (depthPrepassEnabled) {
+				hud->displayMessage("Depth Pre-pass Disabled");
+			}
+			else {
+				hud->displayMessage("Depth Pre-pass Enabled");
+			}
+			depthPrepassEnabled = !depthPrepassEnabled;
+			primary_shader->setDepthPrepassEnabled(depthPrepassEnabled);
+			return true;
+		}
 		if (key == keyTogglePlayerMode) {
 			switch (player ->getPlayerMode()) {
 			case PlayerMode::FLY:
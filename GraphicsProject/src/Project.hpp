@@ -21,15 +21,23 @@ class Project: public CS488Window {
 	TextureManager* textureManager;
 	FlameManager* flameManager;
 	HUD* hud;
+	JobSystem* job_system;				// worker threads for the particles
 
     ClassicShader* primary_shader;
 	PickingShader* picking_shader;
 	ParticleShader* particle_shader;
 	TextShader* text_shader;
 	ShadowShader* shadow_shader;
+	DepthPrepassShader* depth_prepass_shader;
+	GBufferShader* gbuffer_shader;					// the deferred passes, nullptr when drawing forward
+	DeferredLightingPass* deferred_lighting_pass;
+	LanternFilterPass* lantern_filter_pass;
 	SkyboxShader* skybox_shader;
 	SpriteShader* sprite_shader;
 	ShapeShader* shape_shader;
+	SceneUniforms* scene_uniforms;			// camera, light and lantern blocks
+	TransparencyPass* transparency_pass;	// order independent translucent objects and particles
+	OcclusionCuller* occlusion_culler;		// hides what is behind walls, shared by the main and picking passes
 
 	// CR-someday: toggle this with some preprocessing var or something
 	QuadShader* quad_shader; 					// for debugging shadows
@@ -39,7 +47,8 @@ class Project: public CS488Window {
 	Player* player;
 	Flame selectedFlame;
 
-	GeometryNode* selectedObj;
+	// resolved every frame, so a node removed from the scene stops being selected
+	NodeHandle selectedObj;
 
 	glm::mat4 m_perpsective;
 
@@ -63,14 +72,36 @@ class Project: public CS488Window {
 	unsigned int keyToggleTransparency;
 	unsigned int keyToggleSound;
 	unsigned int keyTogglePlayerMode;
+	unsigned int keyTogglePicking;
+	unsigned int keyToggleParticleSort;
+	unsigned int keyToggleParticleBackend;
+	unsigned int keyToggleTransparencyMode;
+	unsigned int keyToggleProfiler;
+	unsigned int keySaveTrace;
+	unsigned int keyToggleOcclusionCulling;
+	unsigned int keyToggleDepthPrepass;
 	unsigned int keyJump;
 
+	// picked at startup, forward if the deferred targets are not supported
+	RenderPath renderPath;
+
 	// flag variables, for objectives that involve multiple shaders
 	bool shouldDrawShadows;
 	bool transparencyEnabled;
+	// pick by casting a ray on the CPU instead of rendering with the picking shader
+	bool cpuPickingEnabled;
+	// lay down the depth of the opaque objects first, so each pixel is only shaded once
+	bool depthPrepassEnabled;
+	TransparencyMode transparencyMode;
+
+	// applies the mode to every shader that draws translucent things
+	void setTransparencyMode(TransparencyMode mode);
 
 protected:
 	void pick();
+	// null if nothing is selected or the selected node has left the scene
+	GeometryNode* getSelectedObj();
+	void setSelectedObj(GeometryNode* node);
 	// for key inputs that are held, like player movement
 	void parsePlayerInput(float elapsedTime);
 
@@ -86,5 +117,5 @@ protected:
 public:
     virtual ~Project();
 
-    Project(); // Prevent direct construction.
+    Project(RenderPath path = RenderPath::Forward); // Prevent direct construction.
 };
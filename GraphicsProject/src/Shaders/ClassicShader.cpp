@@ -9,15 +9,26 @@
 #include <algorithm>
 #include <iostream>
 
-const glm::vec4 DEFAULT_TEXTURE_KD = glm::vec4(1, 1, 1, 1);
-const glm::vec3 DEFAULT_TEXTURE_KS = glm::vec3(0.5, 0.5, 0.5);
-const float DEFAULT_TEXTURE_SHININESS = 10;
-const glm::vec3 AMBIENT_INTENSITY(0.1, 0.1, 0.1);
-
-ClassicShader::ClassicShader(BatchInfoMap* batchInfoMap_, ShadowShader* shadowShader_, bool enableTextures, bool enabledTransparency)
-    : SceneShader(batchInfoMap_, "Phong.vs", "Phong.fs"), shadowShader(shadowShader_), texturesEnabled(enableTextures), 
-	transparencyEnabled(enabledTransparency)
-{}
+ClassicShader::ClassicShader(BatchInfoMap* batchInfoMap_, ShadowShader* shadowShader_, SceneUniforms* sceneUniforms_, 
+	bool enableTextures, bool enabledTransparency)
+    : SceneShader(batchInfoMap_, "Phong.vs", "Phong.fs", sceneUniforms_->getDefines()), 
+	shadowShader(shadowShader_), sceneUniforms(sceneUniforms_), transparencyMode(TransparencyMode::Sorted),
+	texturesEnabled(enableTextures), transparencyEnabled(enabledTransparency), depthPrepassEnabled(false), opaqueDeferred(false)
+{
+	bindUniformBlock("Camera", CAMERA_BLOCK_BINDING);
+	bindUniformBlock("Lights", LIGHT_BLOCK_BINDING);
+	bindUniformBlock("Lanterns", LANTERN_BLOCK_BINDING);
+
+	shadowMapUniform = getUniformHandle("shadowMap");
+	clusterGridUniform = getUniformHandle("clusterGrid");
+	clusterIndicesUniform = getUniformHandle("clusterIndices");
+	materialKdUniform = getUniformHandle("material.kd");
+	materialKsUniform = getUniformHandle("material.ks");
+	materialShininessUniform = getUniformHandle("material.shininess");
+	materialTypeUniform = getUniformHandle("materialType");
+	colourTextureUniform = getUniformHandle("colourTexture");
+	oitPassUniform = getUniformHandle("oitPass");
+}
 
 void ClassicShader::initMeshData(const MeshConsolidator & meshConsolidator) {
     SceneShader::initMeshData(meshConsolidator);
@@ -54,47 +65,59 @@ void ClassicShader::initMeshData(const MeshConsolidator & meshConsolidator) {
 	glBindVertexArray(0);
 }
 
-bool ClassicShader::loadGeometryNodeData(GeometryNode* geometryNode, glm::mat4& fullT) {
-	// set material
-	if (geometryNode->materialType == MaterialType::Plain) {
-		// we draw all the opaque objects first
-		if (geometryNode->material.kd.a < 1 && drawOnlyOpaque) {
-			float dist = glm::length2(glm::vec3(fullT[3])-viewPos);
-			transparentObjects.push_back(TransparencySortData (geometryNode, dist, fullT));
+bool ClassicShader::loadBucketData(const RenderBucket& bucket) {
+	GeometryNode* geometryNode = bucket.node;
+	// we draw all the opaque objects first, transparent ones are sorted and drawn one at a time,
+	// or drawn later by drawTransparent when they do not need sorting.
+	// with transparency off they are opaque like everything else
+	if (geometryNode->materialType == MaterialType::Plain && transparencyEnabled &&
+		geometryNode->material.kd.a < 1 && drawOnlyOpaque) {
+		if (transparencyMode == TransparencyMode::WeightedBlended) {
+			transparentBuckets.push_back((int)(&bucket - renderQueue.buckets.data()));
 			return false;
 		}
-		else {
-			glm::vec4 kd = geometryNode->material.kd;							// diffuse
-			if (!transparencyEnabled) { kd[3] = 1; }
-			glUniform4fv(getUniformLocation("material.kd"), 1, value_ptr(kd));
-			glm::vec3 ks = geometryNode->material.ks;							// specular
-			glUniform3fv(getUniformLocation("material.ks"), 1, value_ptr(ks));
-			float shininess = geometryNode->material.shininess;					// shininess
-			glUniform1f(getUniformLocation("material.shininess"), shininess);
-			glUniform1i(getUniformLocation("materialType"), MATERIAL_PLAIN);	// materialType
-			CHECK_GL_ERRORS;
+		for (int i = bucket.firstInstance; i < bucket.firstInstance + bucket.numInstances; i++) {
+			GeometryNode* node = static_cast<GeometryNode*>(store->nodes[renderQueue.instances[i]]);
+			glm::mat4& fullT = instanceModels[i];
+			float dist = glm::length2(glm::vec3(fullT[3])-viewPos);
+			transparentObjects.push_back(TransparencySortData(node, dist, fullT, bucket.batch));
 		}
+		return false;
+	}
+	if (opaqueDeferred && drawOnlyOpaque) { return false; }
+	loadMaterial(geometryNode);
+	return true;
+}
+
+void ClassicShader::loadMaterial(GeometryNode* geometryNode) {
+	// set material
+	if (geometryNode->materialType == MaterialType::Plain) {
+		glm::vec4 kd = geometryNode->material.kd;							// diffuse
+		if (!transparencyEnabled) { kd[3] = 1; }
+		setUniform(materialKdUniform, kd);
+		setUniform(materialKsUniform, geometryNode->material.ks);			// specular
+		setUniform(materialShininessUniform, geometryNode->material.shininess);
+		setUniform(materialTypeUniform, MATERIAL_PLAIN);					// materialType
+		CHECK_GL_ERRORS;
 	}
 	// set texture
 	else {
 		if (texturesEnabled) {
-			glUniform1i(getUniformLocation("colourTexture"), 1);
+			setUniform(colourTextureUniform, 1);
 			glActiveTexture(GL_TEXTURE1);
 			glBindTexture(GL_TEXTURE_2D, geometryNode->textureId);
-			glUniform1i(getUniformLocation("materialType"), MATERIAL_TEXTURE);
+			setUniform(materialTypeUniform, MATERIAL_TEXTURE);
 			CHECK_GL_ERRORS;
 		}
 		else {
 			// default material if textures not enabled
-			glUniform4fv(getUniformLocation("material.kd"), 1, value_ptr(DEFAULT_TEXTURE_KD));
-			glUniform3fv(getUniformLocation("material.ks"), 1, value_ptr(DEFAULT_TEXTURE_KS));
-			glUniform1f(getUniformLocation("material.shininess"), DEFAULT_TEXTURE_SHININESS);
-			glUniform1i(getUniformLocation("materialType"), MATERIAL_PLAIN);
+			setUniform(materialKdUniform, DEFAULT_TEXTURE_KD);
+			setUniform(materialKsUniform, DEFAULT_TEXTURE_KS);
+			setUniform(materialShininessUniform, DEFAULT_TEXTURE_SHININESS);
+			setUniform(materialTypeUniform, MATERIAL_PLAIN);
 			CHECK_GL_ERRORS;
 		}
 	}
-
-    return SceneShader::loadGeometryNodeData(geometryNode, fullT);
 } 
 
 // these we should not expect to change anytime soon
@@ -119,99 +142,80 @@ void ClassicShader::setTexturesEnabled(bool b) { texturesEnabled = b; }
 
 void ClassicShader::setTransparencyEnabled(bool b) { transparencyEnabled = b; }
 
+void ClassicShader::setDepthPrepassEnabled(bool b) { depthPrepassEnabled = b; }
+
+void ClassicShader::setOpaqueDeferred(bool b) { opaqueDeferred = b; }
+
 bool ClassicShader::getTexturesEnabled() { return texturesEnabled;  }
 
+TransparencyMode ClassicShader::getTransparencyMode() { return transparencyMode; }
+
+void ClassicShader::setTransparencyMode(TransparencyMode mode) { transparencyMode = mode; }
+
 void ClassicShader::drawScene(Scene* scene, glm::mat4 V, glm::vec3 viewP) {
 	viewPos = viewP;
+	store = &scene->getStore();
     enable();
     {
-        // light placements the same when rendering each node
-		std::vector<PointLight*> lights = scene->getPointLights();
-        int numLightsToDraw = std::min(10, (int)lights.size());
-        for (int i=0; i<numLightsToDraw; i++) {
-            std::string position = "pointLights[" + std::to_string(i) + "].position";
-            GLint location = getUniformLocation(position.c_str());
-            glUniform3fv(location, 1, value_ptr(lights[i] -> position));
-
-            std::string intensity = "pointLights[" + std::to_string(i) + "].rgbIntensity";
-            location = getUniformLocation(intensity.c_str());
-            glUniform3fv(location, 1, value_ptr(lights[i] -> rgbIntensity));
-
-            std::string attenuationVals = "pointLights[" + std::to_string(i) + "].attenuationVals";
-            location = getUniformLocation(attenuationVals.c_str());
-            glUniform3fv(location, 1, value_ptr(lights[i] -> attenuationVals));
-        }
-        GLint location = getUniformLocation("numPointLights");
-        glUniform1i(location, numLightsToDraw);
-
-        // directional light
-        DirectionalLight dlight = scene -> getDirectionalLight();
-        location = getUniformLocation("directionalLight.direction");
-        glUniform3fv(location, 1, value_ptr(dlight.direction));
-        location = getUniformLocation("directionalLight.rgbIntensity");
-        glUniform3fv(location, 1, value_ptr(dlight.rgbIntensity));
-
-        // setup shadow map calculations
-        glm::vec3 dirLightPos = shadowShader->getDirLightPosition(viewPos, dlight.direction);
-        glm::mat4 dirLightView = glm::lookAt(dirLightPos, viewPos, glm::vec3(0, 1, 0));
-        glm::mat4 dirLightProjection = shadowShader->getDirLightPerspectiveMatrix();
-        glm::mat4 dirLightSpaceMatrix = dirLightProjection*dirLightView;
-        location = getUniformLocation("dirLightPos");
-        glUniform3fv(location, 1, value_ptr(dirLightPos));
-        location = getUniformLocation("dirLightSpaceMatrix");
-        glUniformMatrix4fv(location, 1, GL_FALSE, value_ptr(dirLightSpaceMatrix));
-        
-        glUniform1i(getUniformLocation("shadowMap"), 0);
+        // lights, lanterns and the camera are in the SceneUniforms blocks
+        setUniform(shadowMapUniform, 0);
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, shadowShader->getDirectionalDepthMap());
-
-        // lantern placements
-        std::vector<Lantern*> lanterns = scene->getLanterns();
-        int numLanterns = std::min(10, (int)lanterns.size());;
-        for (int i=0; i<numLanterns; i++) {
-            std::string position = "lanterns[" + std::to_string(i) + "].position";
-            GLint location = getUniformLocation(position.c_str());
-            glm::vec3 globalPos = lanterns[i]->getLightGlobalPos();
-            glUniform3fv(location, 1, value_ptr(globalPos));
-
-            std::string radius = "lanterns[" + std::to_string(i) + "].radius";
-            location = getUniformLocation(radius.c_str());
-            glUniform1f(location, lanterns[i]->getRadius());
-
-            std::string lanternType = "lanterns[" + std::to_string(i) + "].lanternType";
-            location = getUniformLocation(lanternType.c_str());
-            glUniform1i(location, lanterns[i]->getFlame().id);
-        }
-        location = getUniformLocation("numLanterns");
-        glUniform1i(location, numLanterns);
-
-        // view position
-        location = getUniformLocation("viewPosition");
-        glm::vec3 vP = viewPos;
-        glUniform3fv(location, 1, value_ptr(vP));
+        // the per cluster light lists
+        setUniform(clusterGridUniform, CLUSTER_GRID_TEXTURE_UNIT);
+        setUniform(clusterIndicesUniform, CLUSTER_INDEX_TEXTURE_UNIT);
+        sceneUniforms->getClusters().bindTextures();
         CHECK_GL_ERRORS;
     }
     disable();
 
 	// only draw the opaque objects first
 	transparentObjects.clear();
+	transparentBuckets.clear();
 	drawOnlyOpaque = true;
+	if (depthPrepassEnabled) {
+		glDepthFunc(GL_EQUAL);
+		glDepthMask(GL_FALSE);
+	}
     SceneShader::drawScene(scene, V, viewPos);
+	if (depthPrepassEnabled) {
+		glDepthFunc(GL_LEQUAL);
+		glDepthMask(GL_TRUE);
+	}
 	drawOnlyOpaque = false;
+	if (transparencyMode == TransparencyMode::WeightedBlended) { return; }
 
 	// draw the transparent objects
 	sort(transparentObjects.begin(), transparentObjects.end());
 
+	// each transparent object is its own instance, so it can be drawn in sorted order
+	instanceModels.clear();
+	for (int i = 0; i < transparentObjects.size(); i++) {
+		instanceModels.push_back(transparentObjects[i].fullT);
+	}
 	glBindVertexArray(vao_meshData);
 	enable();
+	instanceModelsOffset = instanceStream.upload(instanceModels.data(), instanceModels.size() * sizeof(glm::mat4));
 	for (int i = 0; i < transparentObjects.size(); i++) {
-		GeometryNode* geometryNode = transparentObjects[i].node;
-		if (loadGeometryNodeData(geometryNode, transparentObjects[i].fullT)) {
-			// Get the BatchInfo corresponding to the GeometryNode's unique MeshId.
-			BatchInfo batchInfo = (*batchInfoMap)[geometryNode->meshId];
-			glDrawArrays(GL_TRIANGLES, batchInfo.startIndex, batchInfo.numIndices);
-		}
+		loadMaterial(transparentObjects[i].node);
+		drawInstanced(transparentObjects[i].batch, i, 1);
+	}
+	disable();
+	glBindVertexArray(0);
+}
+
+void ClassicShader::drawTransparent() {
+	// the instance data from drawScene is still in the stream,
+	// and the buckets can be drawn whole since the order does not matter
+	glBindVertexArray(vao_meshData);
+	enable();
+	setUniform(oitPassUniform, 1);
+	for (int b : transparentBuckets) {
+		const RenderBucket& bucket = renderQueue.buckets[b];
+		loadMaterial(bucket.node);
+		drawInstanced(bucket.batch, bucket.firstInstance, bucket.numInstances);
 	}
+	setUniform(oitPassUniform, 0);
 	disable();
 	glBindVertexArray(0);
 }
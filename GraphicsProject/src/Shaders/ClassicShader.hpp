@@ -1,6 +1,8 @@
 #pragma once
 #include "SceneShader.hpp"
 #include "ShadowShader.hpp"
+#include "SceneUniforms.hpp"
+#include "TransparencyPass.hpp"
 #include "../Application/MeshConsolidator.hpp"
 #include "../Objects/Scene.hpp"
 #include "../Objects/SceneNode.hpp"
@@ -9,13 +11,20 @@
 #define MATERIAL_PLAIN 0
 #define MATERIAL_TEXTURE 1
 
+// shared with the deferred passes, so both renderers look the same
+const glm::vec4 DEFAULT_TEXTURE_KD = glm::vec4(1, 1, 1, 1);
+const glm::vec3 DEFAULT_TEXTURE_KS = glm::vec3(0.5, 0.5, 0.5);
+const float DEFAULT_TEXTURE_SHININESS = 10;
+const glm::vec3 AMBIENT_INTENSITY(0.1, 0.1, 0.1);
+
 // for sorting transparent objects from farthest to closest
 struct TransparencySortData {
 	float dist;
 	GeometryNode* node;
 	glm::mat4 fullT;
-	TransparencySortData(GeometryNode* n, float d, glm::mat4 t)
-		: dist(d), node(n), fullT(t) {}
+	BatchInfo batch;
+	TransparencySortData(GeometryNode* n, float d, glm::mat4 t, BatchInfo b)
+		: dist(d), node(n), fullT(t), batch(b) {}
 	// sort such that farthest transparent objects are first
 	bool operator<(TransparencySortData& other) const {
 		return dist > other.dist;
@@ -24,31 +33,63 @@ struct TransparencySortData {
 
 class ClassicShader : public SceneShader {
     ShadowShader* shadowShader;
+	SceneUniforms* sceneUniforms;
 	std::vector<TransparencySortData> transparentObjects;
+	// translucent buckets of this frame's queue, for the weighted blended pass
+	std::vector<int> transparentBuckets;
+	TransparencyMode transparencyMode;
 
 	// state variables during drawing
 	bool drawOnlyOpaque;
 	glm::vec3 viewPos;
+	SceneStore* store;
+
+	// sets the material uniforms for the given node
+	void loadMaterial(GeometryNode* geometryNode);
+
+	// uniform handles, resolved once in the constructor.
+	// the camera, lights and lanterns come from the SceneUniforms blocks
+	UniformHandle shadowMapUniform;
+	UniformHandle clusterGridUniform;
+	UniformHandle clusterIndicesUniform;
+	UniformHandle materialKdUniform;
+	UniformHandle materialKsUniform;
+	UniformHandle materialShininessUniform;
+	UniformHandle materialTypeUniform;
+	UniformHandle colourTextureUniform;
+	UniformHandle oitPassUniform;
 
 	// flag vars for enabling objectives
 	bool texturesEnabled;
 	bool transparencyEnabled;
+	// the depth buffer already holds the opaque objects, so only shade where it matches
+	bool depthPrepassEnabled;
+	// the opaque objects are drawn by the deferred passes, only the translucent ones are left
+	bool opaqueDeferred;
 
     protected:
-		// return true iff the node should be drawn
-        bool loadGeometryNodeData(GeometryNode* geometryNode, glm::mat4& fullT) override;
+		// return true iff the bucket should be drawn now
+        bool loadBucketData(const RenderBucket& bucket) override;
 
     public:
-        ClassicShader(BatchInfoMap* batchInfoMap_, ShadowShader* shadowShader_, 
+        ClassicShader(BatchInfoMap* batchInfoMap_, ShadowShader* shadowShader_, SceneUniforms* sceneUniforms,
 			bool enabledTextures, bool enableTransparency);
         virtual void initMeshData(const MeshConsolidator& MeshConsolidator) override;
         virtual void loadUniforms(glm::mat4& P, bool shouldDrawShadows);
+        // with TransparencyMode::WeightedBlended only the opaque objects are drawn
         virtual void drawScene(Scene* scene, glm::mat4 V, glm::vec3 viewPos) override;
+		// draws the translucent objects from the last drawScene, unsorted,
+		// between TransparencyPass::begin and composite
+		void drawTransparent();
 
 		// GETTERS + SETTERS
 		void setShadowsEnabled(bool b);
 		void setTexturesEnabled(bool b);
 		bool getTexturesEnabled();
 		void setTransparencyEnabled(bool b);
+		void setDepthPrepassEnabled(bool b);
+		void setOpaqueDeferred(bool b);
+		TransparencyMode getTransparencyMode();
+		void setTransparencyMode(TransparencyMode mode);
 
 };
\ No newline at end of file
@@ -0,0 +1,105 @@
+#include "DeferredLightingPass.hpp"
+#include "ClassicShader.hpp"
+#include "../Application/GlErrorCheck.hpp"
+
+// the shadow map and cluster textures keep the units ClassicShader uses
+const int SHADOW_MAP_TEXTURE_UNIT = 0;
+
+DeferredLightingPass::DeferredLightingPass(GBufferShader* gBuffer_, ShadowShader* shadowShader_,
+	SceneUniforms* sceneUniforms_, int w, int h, bool enableShadows) :
+	width(w), height(h), isSupported(false), gBuffer(gBuffer_), shadowShader(shadowShader_),
+	sceneUniforms(sceneUniforms_), shadowsEnabled(enableShadows)
+{
+	generateProgramObject();
+	setDefines(sceneUniforms->getDefines());
+	attachVertexShader("FullScreen.vs");
+	attachFragmentShader("DeferredLighting.fs");
+	link();
+	bindUniformBlock("Camera", CAMERA_BLOCK_BINDING);
+	bindUniformBlock("Lights", LIGHT_BLOCK_BINDING);
+
+	gBufferUniforms[GBUFFER_POSITION] = getUniformHandle("gPosition");
+	gBufferUniforms[GBUFFER_NORMAL] = getUniformHandle("gNormal");
+	gBufferUniforms[GBUFFER_ALBEDO] = getUniformHandle("gAlbedo");
+	gBufferUniforms[GBUFFER_SPECULAR] = getUniformHandle("gSpecular");
+	shadowMapUniform = getUniformHandle("shadowMap");
+	shadowsEnabledUniform = getUniformHandle("shadowsEnabled");
+	ambientIntensityUniform = getUniformHandle("ambientIntensity");
+	clusterGridUniform = getUniformHandle("clusterGrid");
+	clusterIndicesUniform = getUniformHandle("clusterIndices");
+}
+
+DeferredLightingPass::~DeferredLightingPass() {
+	glDeleteFramebuffers(1, &fbo);
+	glDeleteTextures(1, &litTexture);
+	glDeleteTextures(1, &diffuseTexture);
+	glDeleteVertexArrays(1, &emptyVao);
+}
+
+void DeferredLightingPass::initData() {
+	// more than 8 bits, the lights can add up past 1 before the filters see them
+	GLuint* textures[] = { &litTexture, &diffuseTexture };
+	for (GLuint* texture : textures) {
+		glGenTextures(1, texture);
+		glBindTexture(GL_TEXTURE_2D, *texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_HALF_FLOAT, nullptr);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	// no depth, every covered pixel is lit exactly once
+	glGenFramebuffers(1, &fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, litTexture, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, diffuseTexture, 0);
+	GLenum drawBuffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+	glDrawBuffers(2, drawBuffers);
+	isSupported = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	glGenVertexArrays(1, &emptyVao);
+	CHECK_GL_ERRORS;
+}
+
+void DeferredLightingPass::draw() {
+	GLint prevFramebuffer;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &prevFramebuffer);
+	// pixels nothing covers are never read, so the targets are not cleared
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_BLEND);
+
+	glBindVertexArray(emptyVao);
+	enable();
+	{
+		for (int i = 0; i < NUM_GBUFFER_TARGETS; i++) {
+			setUniform(gBufferUniforms[i], GBUFFER_FIRST_TEXTURE_UNIT + i);
+		}
+		gBuffer->bindTextures(GBUFFER_FIRST_TEXTURE_UNIT);
+		setUniform(shadowMapUniform, SHADOW_MAP_TEXTURE_UNIT);
+		glActiveTexture(GL_TEXTURE0 + SHADOW_MAP_TEXTURE_UNIT);
+		glBindTexture(GL_TEXTURE_2D, shadowShader->getDirectionalDepthMap());
+		setUniform(shadowsEnabledUniform, shadowsEnabled ? 1 : 0);
+		setUniform(ambientIntensityUniform, AMBIENT_INTENSITY);
+		setUniform(clusterGridUniform, CLUSTER_GRID_TEXTURE_UNIT);
+		setUniform(clusterIndicesUniform, CLUSTER_INDEX_TEXTURE_UNIT);
+		sceneUniforms->getClusters().bindTextures();
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+	}
+	disable();
+	glBindVertexArray(0);
+
+	glEnable(GL_BLEND);
+	glEnable(GL_DEPTH_TEST);
+	glBindFramebuffer(GL_FRAMEBUFFER, prevFramebuffer);
+	CHECK_GL_ERRORS;
+}
+
+GLuint DeferredLightingPass::getLitTexture() { return litTexture; }
+
+GLuint DeferredLightingPass::getDiffuseTexture() { return diffuseTexture; }
+
+bool DeferredLightingPass::getIsSupported() { return isSupported; }
+
+void DeferredLightingPass::setShadowsEnabled(bool b) { shadowsEnabled = b; }
@@ -0,0 +1,48 @@
+#pragma once
+#include "ShaderProgram.hpp"
+#include "GBufferShader.hpp"
+#include "ShadowShader.hpp"
+#include "SceneUniforms.hpp"
+
+// Second pass of the deferred renderer. Lights every pixel of the G-buffer once with
+// the directional light and the point lights of its cluster, like Phong.fs does per fragment.
+// The result goes to two targets, the full colour and the colour without specular, which
+// cel shading posterizes. The lantern filters are applied to them by LanternFilterPass
+class DeferredLightingPass : public ShaderProgram {
+	int width, height;
+	bool isSupported;
+
+	GBufferShader* gBuffer;
+	ShadowShader* shadowShader;
+	SceneUniforms* sceneUniforms;
+
+	GLuint fbo;
+	GLuint litTexture;			// rgb: ambient, diffuse and specular, a: transparency
+	GLuint diffuseTexture;		// rgb: ambient and diffuse
+	GLuint emptyVao;			// the full screen triangle has no vertex data
+
+	UniformHandle gBufferUniforms[NUM_GBUFFER_TARGETS];
+	UniformHandle shadowMapUniform;
+	UniformHandle shadowsEnabledUniform;
+	UniformHandle ambientIntensityUniform;
+	UniformHandle clusterGridUniform;
+	UniformHandle clusterIndicesUniform;
+
+	bool shadowsEnabled;
+
+	public:
+		DeferredLightingPass(GBufferShader* gBuffer, ShadowShader* shadowShader, SceneUniforms* sceneUniforms,
+			int w, int h, bool enableShadows);
+		~DeferredLightingPass();
+		void initData();
+
+		// lights the G-buffer filled this frame, the framebuffer bound before is bound again afterwards
+		void draw();
+
+		// the lit colour and the colour without specular, valid after draw
+		GLuint getLitTexture();
+		GLuint getDiffuseTexture();
+		// false if the lighting targets could not be created
+		bool getIsSupported();
+		void setShadowsEnabled(bool b);
+};
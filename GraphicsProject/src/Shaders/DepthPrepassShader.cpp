@@ -0,0 +1,26 @@
+#include "DepthPrepassShader.hpp"
+#include "../Application/GlErrorCheck.hpp"
+
+DepthPrepassShader::DepthPrepassShader(BatchInfoMap* batchInfoMap_, bool transparencyEnabled_) :
+	SceneShader(batchInfoMap_, "Shadow.vs", "Shadow.fs"),
+	transparencyEnabled(transparencyEnabled_)
+{}
+
+bool DepthPrepassShader::loadBucketData(const RenderBucket& bucket) {
+	// translucent objects are blended over the opaque ones later, they must not hide them
+	GeometryNode* geometryNode = bucket.node;
+	if (geometryNode->materialType == MaterialType::Plain &&
+		geometryNode->material.kd.a < 1 && transparencyEnabled) {
+		return false;
+	}
+	return SceneShader::loadBucketData(bucket);
+}
+
+void DepthPrepassShader::drawScene(Scene* scene, glm::mat4 V, glm::vec3 viewPos) {
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	SceneShader::drawScene(scene, V, viewPos);
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	CHECK_GL_ERRORS;
+}
+
+void DepthPrepassShader::setTransparencyEnabled(bool b) { transparencyEnabled = b; }
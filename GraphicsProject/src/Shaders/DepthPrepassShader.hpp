@@ -0,0 +1,23 @@
+#pragma once
+#include "SceneShader.hpp"
+#include "../Application/MeshConsolidator.hpp"
+#include "../Objects/Scene.hpp"
+
+// Fills the depth buffer with the opaque objects before they are shaded, so the
+// expensive Phong pass can test with GL_EQUAL and only shade the visible fragment
+// of each pixel. Only the positions are needed, so it uses the base SceneShader
+// vertex array and the depth only shadow program
+class DepthPrepassShader : public SceneShader {
+	bool transparencyEnabled;
+
+    protected:
+        bool loadBucketData(const RenderBucket& bucket) override;
+
+    public:
+		DepthPrepassShader(BatchInfoMap* batchInfoMap_, bool transparencyEnabled);
+		// writes depth only, the colour buffer is left alone
+		virtual void drawScene(Scene* scene, glm::mat4 V, glm::vec3 viewPos) override;
+
+		// Setters
+		void setTransparencyEnabled(bool b);
+};
@@ -0,0 +1,158 @@
+#include "GBufferShader.hpp"
+#include "../Application/GlErrorCheck.hpp"
+
+GBufferShader::GBufferShader(BatchInfoMap* batchInfoMap_, SceneUniforms* sceneUniforms, int w, int h,
+	bool enableTextures, bool enableTransparency)
+	: SceneShader(batchInfoMap_, "Phong.vs", "GBuffer.fs", sceneUniforms->getDefines()),
+	width(w), height(h), isSupported(false),
+	texturesEnabled(enableTextures), transparencyEnabled(enableTransparency)
+{
+	// Phong.vs reads the camera and the light space matrix from the blocks
+	bindUniformBlock("Camera", CAMERA_BLOCK_BINDING);
+	bindUniformBlock("Lights", LIGHT_BLOCK_BINDING);
+
+	materialKdUniform = getUniformHandle("material.kd");
+	materialKsUniform = getUniformHandle("material.ks");
+	materialShininessUniform = getUniformHandle("material.shininess");
+	materialTypeUniform = getUniformHandle("materialType");
+	colourTextureUniform = getUniformHandle("colourTexture");
+}
+
+GBufferShader::~GBufferShader() {
+	glDeleteFramebuffers(1, &fbo);
+	glDeleteTextures(NUM_GBUFFER_TARGETS, targets);
+	glDeleteRenderbuffers(1, &depthBuffer);
+}
+
+void GBufferShader::initMeshData(const MeshConsolidator & meshConsolidator) {
+	SceneShader::initMeshData(meshConsolidator);
+
+	glBindVertexArray(vao_meshData);
+
+	// normals and texture coordinates, like ClassicShader
+	GLuint vbo_vertexNormals;
+	glGenBuffers(1, &vbo_vertexNormals);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo_vertexNormals);
+	glBufferData(GL_ARRAY_BUFFER, meshConsolidator.getNumVertexNormalBytes(),
+		meshConsolidator.getVertexNormalDataPtr(), GL_STATIC_DRAW);
+	GLint normalAttribLocation = getAttribLocation("normal");
+	glEnableVertexAttribArray(normalAttribLocation);
+	glVertexAttribPointer(normalAttribLocation, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+
+	GLuint vbo_vertexTextures;
+	glGenBuffers(1, &vbo_vertexTextures);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo_vertexTextures);
+	glBufferData(GL_ARRAY_BUFFER, meshConsolidator.getNumUVCoordBytes(),
+		meshConsolidator.getUVCoordDataPtr(), GL_STATIC_DRAW);
+	GLint textureAttribLocation = getAttribLocation("texCoords");
+	glEnableVertexAttribArray(textureAttribLocation);
+	glVertexAttribPointer(textureAttribLocation, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+	CHECK_GL_ERRORS;
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+
+	// positions need full floats to light and filter far away surfaces,
+	// half floats are enough for the normals and the specular, the albedo is 8 bit like the textures
+	GLint internalFormats[NUM_GBUFFER_TARGETS] = { GL_RGBA32F, GL_RGBA16F, GL_RGBA8, GL_RGBA16F };
+	GLenum types[NUM_GBUFFER_TARGETS] = { GL_FLOAT, GL_HALF_FLOAT, GL_UNSIGNED_BYTE, GL_HALF_FLOAT };
+	glGenTextures(NUM_GBUFFER_TARGETS, targets);
+	for (int i = 0; i < NUM_GBUFFER_TARGETS; i++) {
+		glBindTexture(GL_TEXTURE_2D, targets[i]);
+		glTexImage2D(GL_TEXTURE_2D, 0, internalFormats[i], width, height, 0, GL_RGBA, types[i], nullptr);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	// same format as the default framebuffer, so the depth can be blitted across
+	glGenRenderbuffers(1, &depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	GLenum drawBuffers[NUM_GBUFFER_TARGETS];
+	for (int i = 0; i < NUM_GBUFFER_TARGETS; i++) {
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, targets[i], 0);
+		drawBuffers[i] = GL_COLOR_ATTACHMENT0 + i;
+	}
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+	glDrawBuffers(NUM_GBUFFER_TARGETS, drawBuffers);
+	isSupported = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	CHECK_GL_ERRORS;
+}
+
+bool GBufferShader::loadBucketData(const RenderBucket& bucket) {
+	GeometryNode* geometryNode = bucket.node;
+	if (geometryNode->materialType == MaterialType::Plain &&
+		geometryNode->material.kd.a < 1 && transparencyEnabled) {
+		return false;
+	}
+	loadMaterial(geometryNode);
+	return true;
+}
+
+void GBufferShader::loadMaterial(GeometryNode* geometryNode) {
+	if (geometryNode->materialType == MaterialType::Plain) {
+		glm::vec4 kd = geometryNode->material.kd;
+		if (!transparencyEnabled) { kd[3] = 1; }
+		setUniform(materialKdUniform, kd);
+		setUniform(materialKsUniform, geometryNode->material.ks);
+		setUniform(materialShininessUniform, geometryNode->material.shininess);
+		setUniform(materialTypeUniform, MATERIAL_PLAIN);
+	}
+	else if (texturesEnabled) {
+		setUniform(colourTextureUniform, 1);
+		glActiveTexture(GL_TEXTURE1);
+		glBindTexture(GL_TEXTURE_2D, geometryNode->textureId);
+		setUniform(materialTypeUniform, MATERIAL_TEXTURE);
+	}
+	else {
+		// default material if textures not enabled
+		setUniform(materialKdUniform, DEFAULT_TEXTURE_KD);
+		setUniform(materialKsUniform, DEFAULT_TEXTURE_KS);
+		setUniform(materialShininessUniform, DEFAULT_TEXTURE_SHININESS);
+		setUniform(materialTypeUniform, MATERIAL_PLAIN);
+	}
+	CHECK_GL_ERRORS;
+}
+
+void GBufferShader::drawScene(Scene* scene, glm::mat4 V, glm::vec3 viewPos) {
+	GLint prevFramebuffer;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &prevFramebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+
+	// a material id of 0 marks the pixels nothing covers
+	GLfloat clearTarget[] = { 0, 0, 0, 0 };
+	for (int i = 0; i < NUM_GBUFFER_TARGETS; i++) { glClearBufferfv(GL_COLOR, i, clearTarget); }
+	glClear(GL_DEPTH_BUFFER_BIT);
+	// the targets hold data, not colours, so nothing may be blended into them
+	glDisable(GL_BLEND);
+	SceneShader::drawScene(scene, V, viewPos);
+	glEnable(GL_BLEND);
+
+	// the framebuffer gets the opaque depth, the colour comes later from the lighting
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, prevFramebuffer);
+	glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, prevFramebuffer);
+	CHECK_GL_ERRORS;
+}
+
+void GBufferShader::bindTextures(int firstUnit) {
+	for (int i = 0; i < NUM_GBUFFER_TARGETS; i++) {
+		glActiveTexture(GL_TEXTURE0 + firstUnit + i);
+		glBindTexture(GL_TEXTURE_2D, targets[i]);
+	}
+	glActiveTexture(GL_TEXTURE0);
+	CHECK_GL_ERRORS;
+}
+
+bool GBufferShader::getIsSupported() { return isSupported; }
+
+void GBufferShader::setTexturesEnabled(bool b) { texturesEnabled = b; }
+
+void GBufferShader::setTransparencyEnabled(bool b) { transparencyEnabled = b; }
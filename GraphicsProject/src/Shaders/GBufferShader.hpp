@@ -0,0 +1,67 @@
+#pragma once
+#include "SceneShader.hpp"
+#include "ClassicShader.hpp"
+#include "SceneUniforms.hpp"
+#include "../Application/MeshConsolidator.hpp"
+#include "../Objects/Scene.hpp"
+
+// picked once at startup, see main.cpp
+enum class RenderPath {
+	Forward,			// every opaque object is lit as it is drawn
+	Deferred			// opaque objects go to the G-buffer, then are lit once per pixel
+};
+
+// colour attachments of the G-buffer, make sure these line up with GBuffer.fs
+const int GBUFFER_POSITION = 0;		// xyz: world position
+const int GBUFFER_NORMAL = 1;		// xyz: normal, w: material id, 0 where nothing was drawn
+const int GBUFFER_ALBEDO = 2;		// rgb: kd, a: transparency
+const int GBUFFER_SPECULAR = 3;		// rgb: ks, a: shininess
+const int NUM_GBUFFER_TARGETS = 4;
+// the later passes read the G-buffer from here on, after the shadow map and the cluster textures
+const int GBUFFER_FIRST_TEXTURE_UNIT = 4;
+
+// First pass of the deferred renderer. Draws the opaque objects into the G-buffer
+// without lighting them, then copies their depth into the framebuffer so the sky
+// and the translucent objects drawn forward afterwards are hidden by them
+class GBufferShader : public SceneShader {
+	int width, height;
+	bool isSupported;
+
+	GLuint fbo;
+	GLuint targets[NUM_GBUFFER_TARGETS];
+	GLuint depthBuffer;
+
+	// sets the material uniforms for the given node
+	void loadMaterial(GeometryNode* geometryNode);
+
+	UniformHandle materialKdUniform;
+	UniformHandle materialKsUniform;
+	UniformHandle materialShininessUniform;
+	UniformHandle materialTypeUniform;
+	UniformHandle colourTextureUniform;
+
+	// flag vars for enabling objectives
+	bool texturesEnabled;
+	bool transparencyEnabled;
+
+    protected:
+		// translucent buckets are left for the forward pass
+        bool loadBucketData(const RenderBucket& bucket) override;
+
+    public:
+		GBufferShader(BatchInfoMap* batchInfoMap_, SceneUniforms* sceneUniforms, int w, int h,
+			bool enableTextures, bool enableTransparency);
+		~GBufferShader();
+		virtual void initMeshData(const MeshConsolidator& MeshConsolidator) override;
+		// fills the G-buffer, the framebuffer bound before is bound again afterwards
+		virtual void drawScene(Scene* scene, glm::mat4 V, glm::vec3 viewPos) override;
+
+		// binds every G-buffer texture, the one for attachment i goes to unit firstUnit + i
+		void bindTextures(int firstUnit);
+		// false if the G-buffer could not be created, use the forward path then
+		bool getIsSupported();
+
+		// Setters
+		void setTexturesEnabled(bool b);
+		void setTransparencyEnabled(bool b);
+};
@@ -0,0 +1,66 @@
+#include "LanternFilterPass.hpp"
+#include "../Application/GlErrorCheck.hpp"
+
+// the lighting targets take the units below the cluster textures
+const int LIT_TEXTURE_UNIT = 0;
+const int DIFFUSE_TEXTURE_UNIT = 1;
+
+LanternFilterPass::LanternFilterPass(GBufferShader* gBuffer_, DeferredLightingPass* lighting_,
+	SceneUniforms* sceneUniforms_) :
+	gBuffer(gBuffer_), lighting(lighting_), sceneUniforms(sceneUniforms_)
+{
+	generateProgramObject();
+	setDefines(sceneUniforms->getDefines());
+	attachVertexShader("FullScreen.vs");
+	attachFragmentShader("LanternFilters.fs");
+	link();
+	bindUniformBlock("Camera", CAMERA_BLOCK_BINDING);
+	bindUniformBlock("Lights", LIGHT_BLOCK_BINDING);
+	bindUniformBlock("Lanterns", LANTERN_BLOCK_BINDING);
+
+	litColourUniform = getUniformHandle("litColour");
+	diffuseColourUniform = getUniformHandle("diffuseColour");
+	positionUniform = getUniformHandle("gPosition");
+	normalUniform = getUniformHandle("gNormal");
+	clusterGridUniform = getUniformHandle("clusterGrid");
+	clusterIndicesUniform = getUniformHandle("clusterIndices");
+}
+
+LanternFilterPass::~LanternFilterPass() {
+	glDeleteVertexArrays(1, &emptyVao);
+}
+
+void LanternFilterPass::initData() {
+	glGenVertexArrays(1, &emptyVao);
+	CHECK_GL_ERRORS;
+}
+
+void LanternFilterPass::draw() {
+	// the G-buffer depth is already in the framebuffer, the colour is blended
+	// over the sky like the forward path does
+	glDisable(GL_DEPTH_TEST);
+
+	glBindVertexArray(emptyVao);
+	enable();
+	{
+		setUniform(litColourUniform, LIT_TEXTURE_UNIT);
+		setUniform(diffuseColourUniform, DIFFUSE_TEXTURE_UNIT);
+		setUniform(positionUniform, GBUFFER_FIRST_TEXTURE_UNIT + GBUFFER_POSITION);
+		setUniform(normalUniform, GBUFFER_FIRST_TEXTURE_UNIT + GBUFFER_NORMAL);
+		gBuffer->bindTextures(GBUFFER_FIRST_TEXTURE_UNIT);
+		glActiveTexture(GL_TEXTURE0 + LIT_TEXTURE_UNIT);
+		glBindTexture(GL_TEXTURE_2D, lighting->getLitTexture());
+		glActiveTexture(GL_TEXTURE0 + DIFFUSE_TEXTURE_UNIT);
+		glBindTexture(GL_TEXTURE_2D, lighting->getDiffuseTexture());
+		setUniform(clusterGridUniform, CLUSTER_GRID_TEXTURE_UNIT);
+		setUniform(clusterIndicesUniform, CLUSTER_INDEX_TEXTURE_UNIT);
+		sceneUniforms->getClusters().bindTextures();
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+		glActiveTexture(GL_TEXTURE0);
+	}
+	disable();
+	glBindVertexArray(0);
+
+	glEnable(GL_DEPTH_TEST);
+	CHECK_GL_ERRORS;
+}
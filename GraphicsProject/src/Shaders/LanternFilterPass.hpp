@@ -0,0 +1,32 @@
+#pragma once
+#include "ShaderProgram.hpp"
+#include "GBufferShader.hpp"
+#include "DeferredLightingPass.hpp"
+#include "SceneUniforms.hpp"
+
+// Last pass of the deferred renderer. One full screen pass applies the LANTERN_* filters
+// to the lit G-buffer and blends it over the framebuffer. Each pixel only looks at the
+// lanterns of its light cluster, so the clusters act as the screen space tiles of each
+// lantern's radius and pixels outside every radius cost a single lookup
+class LanternFilterPass : public ShaderProgram {
+	GBufferShader* gBuffer;
+	DeferredLightingPass* lighting;
+	SceneUniforms* sceneUniforms;
+
+	GLuint emptyVao;			// the full screen triangle has no vertex data
+
+	UniformHandle litColourUniform;
+	UniformHandle diffuseColourUniform;
+	UniformHandle positionUniform;
+	UniformHandle normalUniform;
+	UniformHandle clusterGridUniform;
+	UniformHandle clusterIndicesUniform;
+
+	public:
+		LanternFilterPass(GBufferShader* gBuffer, DeferredLightingPass* lighting, SceneUniforms* sceneUniforms);
+		~LanternFilterPass();
+		void initData();
+
+		// draws the filtered opaque objects into the bound framebuffer
+		void draw();
+};
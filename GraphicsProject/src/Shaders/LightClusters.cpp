@@ -0,0 +1,221 @@
+#include "LightClusters.hpp"
+#include "../Application/GlErrorCheck.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// a light is cut off once it contributes less than this to any channel
+const float LIGHT_CUTOFF = 1.0f / 256.0f;
+// lanterns blend white into a ring around their radius, see Phong.fs
+const float LANTERN_RING_SQUARE_WIDTH = 10;
+
+// distance at which the attenuated light falls below the cutoff, negative if never.
+// 0 if it is below the cutoff everywhere, e.g. a lantern light fading in or out
+static float getLightRadius(PointLight* light) {
+	float intensity = std::max(light->rgbIntensity.r, std::max(light->rgbIntensity.g, light->rgbIntensity.b));
+	glm::vec3 a = light->attenuationVals;
+	// solve a0 + a1*d + a2*d^2 = intensity/cutoff
+	float c = a[0] - intensity / LIGHT_CUTOFF;
+	if (!(c < 0)) { return 0; }
+	if (a[2] > 0) {
+		float discriminant = a[1] * a[1] - 4 * a[2] * c;
+		if (!(discriminant > 0)) { return 0; }
+		return (-a[1] + sqrt(discriminant)) / (2 * a[2]);
+	}
+	if (a[1] > 0) { return std::max(0.0f, -c / a[1]); }
+	return -1;
+}
+
+static float getLanternRadius(Lantern* lantern) {
+	float r = lantern->getRadius();
+	if (r <= 0.01f) { return r; }
+	return sqrt(r * r + LANTERN_RING_SQUARE_WIDTH);
+}
+
+static int getTile(float ndc, int numTiles) {
+	int tile = (int)floor((ndc * 0.5f + 0.5f) * numTiles);
+	return std::min(numTiles - 1, std::max(0, tile));
+}
+
+LightClusters::LightClusters() : boundsProjection(0), nearPlane(0), farPlane(0),
+	tanHalfX(0), tanHalfY(0), sliceScale(0),
+	gridBuffer(0), gridTexture(0), indexBuffer(0), indexTexture(0) {}
+
+void LightClusters::initData() {
+	pointCounts.resize(NUM_CLUSTERS);
+	lanternCounts.resize(NUM_CLUSTERS);
+	gridData.resize(2 * NUM_CLUSTERS);
+
+	// offset and packed counts for each cluster
+	glGenBuffers(1, &gridBuffer);
+	glBindBuffer(GL_TEXTURE_BUFFER, gridBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, gridData.size() * sizeof(unsigned int), nullptr, GL_STREAM_DRAW);
+	glGenTextures(1, &gridTexture);
+	glBindTexture(GL_TEXTURE_BUFFER, gridTexture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32UI, gridBuffer);
+
+	// the index lists, grown as needed
+	glGenBuffers(1, &indexBuffer);
+	glBindBuffer(GL_TEXTURE_BUFFER, indexBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, sizeof(unsigned int), nullptr, GL_STREAM_DRAW);
+	glGenTextures(1, &indexTexture);
+	glBindTexture(GL_TEXTURE_BUFFER, indexTexture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, indexBuffer);
+
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	CHECK_GL_ERRORS;
+}
+
+void LightClusters::buildBounds(const glm::mat4& P) {
+	boundsProjection = P;
+	// recover the frustum from the perspective matrix
+	nearPlane = P[3][2] / (P[2][2] - 1);
+	farPlane = P[3][2] / (P[2][2] + 1);
+	tanHalfX = 1 / P[0][0];
+	tanHalfY = 1 / P[1][1];
+	sliceScale = CLUSTER_GRID_Z / log(farPlane / nearPlane);
+
+	sliceDepths.resize(CLUSTER_GRID_Z + 1);
+	for (int z = 0; z <= CLUSTER_GRID_Z; z++) {
+		sliceDepths[z] = nearPlane * pow(farPlane / nearPlane, (float)z / CLUSTER_GRID_Z);
+	}
+
+	bounds.resize(NUM_CLUSTERS);
+	for (int z = 0; z < CLUSTER_GRID_Z; z++) {
+		float dn = sliceDepths[z];
+		float df = sliceDepths[z + 1];
+		for (int y = 0; y < CLUSTER_GRID_Y; y++) {
+			float y0 = (-1 + 2.0f * y / CLUSTER_GRID_Y) * tanHalfY;
+			float y1 = (-1 + 2.0f * (y + 1) / CLUSTER_GRID_Y) * tanHalfY;
+			for (int x = 0; x < CLUSTER_GRID_X; x++) {
+				float x0 = (-1 + 2.0f * x / CLUSTER_GRID_X) * tanHalfX;
+				float x1 = (-1 + 2.0f * (x + 1) / CLUSTER_GRID_X) * tanHalfX;
+				// the tile widens with depth, so take the extremes of both ends
+				ClusterBounds& b = bounds[x + CLUSTER_GRID_X * (y + CLUSTER_GRID_Y * z)];
+				b.min = glm::vec3(std::min(x0 * dn, x0 * df), std::min(y0 * dn, y0 * df), dn);
+				b.max = glm::vec3(std::max(x1 * dn, x1 * df), std::max(y1 * dn, y1 * df), df);
+			}
+		}
+	}
+}
+
+int LightClusters::getSlice(float depth) {
+	// also catches NaN, which must never be cast to an int
+	if (!(depth > nearPlane)) { return 0; }
+	float slice = log(depth / nearPlane) * sliceScale;
+	if (!(slice < CLUSTER_GRID_Z - 1)) { return CLUSTER_GRID_Z - 1; }
+	return (int)slice;
+}
+
+void LightClusters::assign(LightSphere sphere, unsigned int index,
+	std::vector<ClusterEntry>& entries, std::vector<unsigned int>& counts)
+{
+	if (std::isnan(sphere.radius)) { return; }
+	// reaches everything, e.g. a light without attenuation
+	if (sphere.radius < 0) {
+		for (unsigned int c = 0; c < NUM_CLUSTERS; c++) {
+			entries.push_back({ c, index });
+			counts[c]++;
+		}
+		return;
+	}
+
+	glm::vec3 center = sphere.center;
+	float r = sphere.radius;
+	if (center.z + r < nearPlane || center.z - r > farPlane) { return; }
+
+	int z0 = getSlice(center.z - r);
+	int z1 = getSlice(center.z + r);
+	for (int z = z0; z <= z1; z++) {
+		// depths of the sphere inside this slice
+		float d0 = std::max(sliceDepths[z], center.z - r);
+		float d1 = std::min(sliceDepths[z + 1], center.z + r);
+		if (d0 > d1) { continue; }
+
+		// conservative tile range, the projected extent is widest at one of the ends
+		int x0 = getTile(std::min((center.x - r) / (d0 * tanHalfX), (center.x - r) / (d1 * tanHalfX)), CLUSTER_GRID_X);
+		int x1 = getTile(std::max((center.x + r) / (d0 * tanHalfX), (center.x + r) / (d1 * tanHalfX)), CLUSTER_GRID_X);
+		int y0 = getTile(std::min((center.y - r) / (d0 * tanHalfY), (center.y - r) / (d1 * tanHalfY)), CLUSTER_GRID_Y);
+		int y1 = getTile(std::max((center.y + r) / (d0 * tanHalfY), (center.y + r) / (d1 * tanHalfY)), CLUSTER_GRID_Y);
+
+		for (int y = y0; y <= y1; y++) {
+			for (int x = x0; x <= x1; x++) {
+				unsigned int c = x + CLUSTER_GRID_X * (y + CLUSTER_GRID_Y * z);
+				// exact sphere and box test
+				glm::vec3 closest = glm::clamp(center, bounds[c].min, bounds[c].max);
+				glm::vec3 delta = closest - center;
+				if (glm::dot(delta, delta) > r * r) { continue; }
+				entries.push_back({ c, index });
+				counts[c]++;
+			}
+		}
+	}
+}
+
+void LightClusters::update(const glm::mat4& V, const glm::mat4& P,
+	const std::vector<PointLight*>& lights, int numLights,
+	const std::vector<Lantern*>& lanterns, int numLanterns)
+{
+	if (P != boundsProjection) { buildBounds(P); }
+
+	pointEntries.clear();
+	lanternEntries.clear();
+	std::fill(pointCounts.begin(), pointCounts.end(), 0);
+	std::fill(lanternCounts.begin(), lanternCounts.end(), 0);
+
+	// view space, with depth positive
+	for (int i = 0; i < numLights; i++) {
+		// too dim to light anything, this includes lights that are off
+		float radius = getLightRadius(lights[i]);
+		if (radius == 0) { continue; }
+		glm::vec3 pos = glm::vec3(V * glm::vec4(lights[i]->position, 1));
+		pos.z = -pos.z;
+		assign({ pos, radius }, i, pointEntries, pointCounts);
+	}
+	for (int i = 0; i < numLanterns; i++) {
+		glm::vec3 pos = glm::vec3(V * glm::vec4(lanterns[i]->getLightGlobalPos(), 1));
+		pos.z = -pos.z;
+		assign({ pos, getLanternRadius(lanterns[i]) }, i, lanternEntries, lanternCounts);
+	}
+
+	// each cluster's list is its point lights then its lanterns
+	unsigned int offset = 0;
+	for (int c = 0; c < NUM_CLUSTERS; c++) {
+		gridData[2 * c] = offset;
+		gridData[2 * c + 1] = (pointCounts[c] << 16) | lanternCounts[c];
+		offset += pointCounts[c] + lanternCounts[c];
+	}
+	// entries were added in light order, so each list stays sorted.
+	// lanterns are applied in order in the shader, so this keeps the same result
+	indexData.resize(std::max(offset, 1u));
+	std::fill(pointCounts.begin(), pointCounts.end(), 0);
+	std::fill(lanternCounts.begin(), lanternCounts.end(), 0);
+	for (const ClusterEntry& e : pointEntries) {
+		indexData[gridData[2 * e.cluster] + pointCounts[e.cluster]++] = e.index;
+	}
+	for (const ClusterEntry& e : lanternEntries) {
+		unsigned int numPoints = gridData[2 * e.cluster + 1] >> 16;
+		indexData[gridData[2 * e.cluster] + numPoints + lanternCounts[e.cluster]++] = e.index;
+	}
+
+	// orphan the old storage, the previous frame may still be reading it
+	glBindBuffer(GL_TEXTURE_BUFFER, gridBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, gridData.size() * sizeof(unsigned int), gridData.data(), GL_STREAM_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, indexBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, indexData.size() * sizeof(unsigned int), indexData.data(), GL_STREAM_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	CHECK_GL_ERRORS;
+}
+
+void LightClusters::bindTextures() {
+	glActiveTexture(GL_TEXTURE0 + CLUSTER_GRID_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_BUFFER, gridTexture);
+	glActiveTexture(GL_TEXTURE0 + CLUSTER_INDEX_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_BUFFER, indexTexture);
+	glActiveTexture(GL_TEXTURE0);
+	CHECK_GL_ERRORS;
+}
+
+glm::ivec4 LightClusters::getDims() { return glm::ivec4(CLUSTER_GRID_X, CLUSTER_GRID_Y, CLUSTER_GRID_Z, 0); }
+glm::vec4 LightClusters::getDepthParams() { return glm::vec4(nearPlane, farPlane, sliceScale, 0); }
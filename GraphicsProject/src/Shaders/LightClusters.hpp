@@ -0,0 +1,77 @@
+#pragma once
+#include "../Objects/LightSource.hpp"
+#include "../Objects/Lantern.hpp"
+#include "../OpenGLImport.hpp"
+
+#include <glm/glm.hpp>
+#include <vector>
+
+// size of the froxel grid: x and y are screen tiles, z are exponential depth slices
+const int CLUSTER_GRID_X = 16;
+const int CLUSTER_GRID_Y = 9;
+const int CLUSTER_GRID_Z = 24;
+const int NUM_CLUSTERS = CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z;
+
+// texture units for the light lists, after the shadow map and colour texture
+const int CLUSTER_GRID_TEXTURE_UNIT = 2;
+const int CLUSTER_INDEX_TEXTURE_UNIT = 3;
+
+// Assigns point lights and lanterns to the view frustum clusters they overlap.
+// Each cluster gets a list of light indices followed by lantern indices, so the
+// fragment shader only evaluates what can reach it
+class LightClusters {
+	// bounds of a cluster in view space, with z flipped to be the positive depth
+	struct ClusterBounds {
+		glm::vec3 min;
+		glm::vec3 max;
+	};
+	// a light or lantern sphere in view space, negative radius reaches every cluster
+	struct LightSphere {
+		glm::vec3 center;
+		float radius;
+	};
+	struct ClusterEntry {
+		unsigned int cluster;
+		unsigned int index;
+	};
+
+	std::vector<ClusterBounds> bounds;
+	std::vector<float> sliceDepths;
+	glm::mat4 boundsProjection;
+	float nearPlane;
+	float farPlane;
+	float tanHalfX;
+	float tanHalfY;
+	float sliceScale;
+
+	// rebuilt every frame
+	std::vector<ClusterEntry> pointEntries;
+	std::vector<ClusterEntry> lanternEntries;
+	std::vector<unsigned int> pointCounts;
+	std::vector<unsigned int> lanternCounts;
+	std::vector<unsigned int> gridData;
+	std::vector<unsigned int> indexData;
+
+	GLuint gridBuffer;
+	GLuint gridTexture;
+	GLuint indexBuffer;
+	GLuint indexTexture;
+
+	// only needs to happen when the projection changes
+	void buildBounds(const glm::mat4& P);
+	int getSlice(float depth);
+	void assign(LightSphere sphere, unsigned int index,
+		std::vector<ClusterEntry>& entries, std::vector<unsigned int>& counts);
+
+	public:
+		LightClusters();
+		void initData();
+		void update(const glm::mat4& V, const glm::mat4& P,
+			const std::vector<PointLight*>& lights, int numLights,
+			const std::vector<Lantern*>& lanterns, int numLanterns);
+		void bindTextures();
+
+		// grid size and depth slicing, the shader needs these to find its cluster
+		glm::ivec4 getDims();
+		glm::vec4 getDepthParams();
+};
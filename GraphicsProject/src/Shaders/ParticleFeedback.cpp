@@ -0,0 +1,144 @@
+#include "ParticleFeedback.hpp"
+#include "ParticleShader.hpp"
+#include "../Application/GlErrorCheck.hpp"
+
+#include <algorithm>
+
+ParticleFeedback::ParticleFeedback(unsigned int maxParticles_) :
+	maxParticles(maxParticles_), current(0), ringHead(0), simTime(0), lastExpiry(0), nextFreeTime(0)
+{
+	slotExpiry.resize(maxParticles);
+
+	generateProgramObject();
+	attachVertexShader("ParticleUpdate.vs");
+	setTransformFeedbackVaryings({ "outOffset", "outColour", "outVelocity", "outFadeRate" });
+	link();
+	timeElapsedUniform = getUniformHandle("timeElapsed");
+}
+
+ParticleFeedback::~ParticleFeedback() {
+	glDeleteVertexArrays(2, updateVaos);
+	glDeleteBuffers(2, stateBuffers);
+}
+
+void ParticleFeedback::initData() {
+	// everything starts dead, with no size
+	std::vector<ParticleGpuState> empty(maxParticles, ParticleGpuState());
+	glGenBuffers(2, stateBuffers);
+	glGenVertexArrays(2, updateVaos);
+	const char* names[] = { "offset", "colour", "velocity", "fadeRate" };
+	for (int i = 0; i < 2; i++) {
+		glBindBuffer(GL_ARRAY_BUFFER, stateBuffers[i]);
+		glBufferData(GL_ARRAY_BUFFER, maxParticles * sizeof(ParticleGpuState), empty.data(), GL_DYNAMIC_COPY);
+
+		glBindVertexArray(updateVaos[i]);
+		for (int j = 0; j < 4; j++) {
+			GLint location = getAttribLocation(names[j]);
+			glEnableVertexAttribArray(location);
+			glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(ParticleGpuState),
+				(void*)(j * sizeof(glm::vec4)));
+		}
+	}
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	CHECK_GL_ERRORS;
+}
+
+bool ParticleFeedback::addParticle(const ParticleSpawn& spawn) {
+	if (spawn.life <= 0 || simTime < nextFreeTime) { return false; }
+	// skip over slots that are still alive
+	float earliestExpiry = slotExpiry[ringHead];
+	for (unsigned int tries = 1; slotExpiry[ringHead] > simTime; tries++) {
+		if (tries == maxParticles) {
+			nextFreeTime = earliestExpiry;
+			return false;
+		}
+		ringHead = (ringHead + 1) % maxParticles;
+		earliestExpiry = std::min(earliestExpiry, slotExpiry[ringHead]);
+	}
+	ParticleGpuState state;
+	state.offset = glm::vec4(spawn.pos, spawn.size);
+	state.colour = spawn.colour;
+	state.velocity = glm::vec4(spawn.velocity, spawn.life);
+	state.fadeRate = spawn.fadeRate;
+	pendingSpawns.push_back(state);
+	pendingSlots.push_back(ringHead);
+
+	slotExpiry[ringHead] = simTime + spawn.life;
+	lastExpiry = std::max(lastExpiry, slotExpiry[ringHead]);
+	ringHead = (ringHead + 1) % maxParticles;
+	return true;
+}
+
+void ParticleFeedback::uploadSpawns() {
+	if (pendingSpawns.empty()) { return; }
+	// slots are consecutive except where the ring wraps
+	glBindBuffer(GL_ARRAY_BUFFER, stateBuffers[current]);
+	size_t runStart = 0;
+	for (size_t i = 1; i <= pendingSlots.size(); i++) {
+		if (i < pendingSlots.size() && pendingSlots[i] == pendingSlots[i - 1] + 1) { continue; }
+		glBufferSubData(GL_ARRAY_BUFFER, pendingSlots[runStart] * sizeof(ParticleGpuState),
+			(i - runStart) * sizeof(ParticleGpuState), &pendingSpawns[runStart]);
+		runStart = i;
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	CHECK_GL_ERRORS;
+	pendingSpawns.clear();
+	pendingSlots.clear();
+}
+
+void ParticleFeedback::tick(float timeElapsed) {
+	uploadSpawns();
+	// every particle is already dead, nothing would change
+	if (simTime > lastExpiry) {
+		simTime += timeElapsed;
+		return;
+	}
+
+	unsigned int next = 1 - current;
+	enable();
+	setUniform(timeElapsedUniform, timeElapsed);
+	glEnable(GL_RASTERIZER_DISCARD);
+	glBindVertexArray(updateVaos[current]);
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, stateBuffers[next]);
+	glBeginTransformFeedback(GL_POINTS);
+	glDrawArrays(GL_POINTS, 0, maxParticles);
+	glEndTransformFeedback();
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+	glBindVertexArray(0);
+	glDisable(GL_RASTERIZER_DISCARD);
+	disable();
+	CHECK_GL_ERRORS;
+
+	current = next;
+	simTime += timeElapsed;
+}
+
+void ParticleFeedback::clear() {
+	std::vector<ParticleGpuState> empty(maxParticles, ParticleGpuState());
+	for (int i = 0; i < 2; i++) {
+		glBindBuffer(GL_ARRAY_BUFFER, stateBuffers[i]);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, maxParticles * sizeof(ParticleGpuState), empty.data());
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	CHECK_GL_ERRORS;
+	std::fill(slotExpiry.begin(), slotExpiry.end(), 0.0f);
+	pendingSpawns.clear();
+	pendingSlots.clear();
+	ringHead = 0;
+	simTime = 0;
+	lastExpiry = 0;
+	nextFreeTime = 0;
+}
+
+GLuint ParticleFeedback::getStateBuffer(unsigned int i) { return stateBuffers[i]; }
+unsigned int ParticleFeedback::getCurrentBuffer() { return current; }
+unsigned int ParticleFeedback::getMaxParticles() { return maxParticles; }
+
+unsigned int ParticleFeedback::getNumAlive() {
+	unsigned int n = 0;
+	for (float expiry : slotExpiry) {
+		if (expiry > simTime) { n++; }
+	}
+	return n;
+}
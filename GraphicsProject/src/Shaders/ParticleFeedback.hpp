@@ -0,0 +1,54 @@
+#pragma once
+#include "ShaderProgram.hpp"
+#include <glm/glm.hpp>
+#include <vector>
+
+struct ParticleSpawn;
+
+// one particle in the GPU buffers, the same layout as the transform feedback outputs
+struct ParticleGpuState {
+	glm::vec4 offset;		// position and size
+	glm::vec4 colour;
+	glm::vec4 velocity;		// w is the remaining life
+	glm::vec4 fadeRate;
+};
+
+// Keeps the particles on the GPU in two buffers. Each tick runs ParticleUpdate.vs
+// over one buffer and captures the result in the other with transform feedback,
+// so the CPU only uploads newly spawned particles
+class ParticleFeedback : public ShaderProgram {
+	unsigned int maxParticles;
+	GLuint stateBuffers[2];
+	GLuint updateVaos[2];		// read from the buffer with the same index
+	unsigned int current;		// buffer with the latest state
+
+	// new particles go in a ring, the CPU knows when each slot's particle dies
+	// so nothing alive gets overwritten and nothing has to be read back
+	unsigned int ringHead;
+	float simTime;
+	float lastExpiry;
+	float nextFreeTime;			// when every slot is alive, the first time one frees up
+	std::vector<float> slotExpiry;
+	std::vector<ParticleGpuState> pendingSpawns;
+	std::vector<unsigned int> pendingSlots;
+
+	UniformHandle timeElapsedUniform;
+
+	void uploadSpawns();
+
+	public:
+		ParticleFeedback(unsigned int maxParticles_);
+		~ParticleFeedback();
+		void initData();
+
+		// false if every slot is still alive
+		bool addParticle(const ParticleSpawn& spawn);
+		void tick(float timeElapsed);
+		void clear();
+
+		GLuint getStateBuffer(unsigned int i);
+		unsigned int getCurrentBuffer();
+		unsigned int getMaxParticles();
+		// the CPU knows every slot's expiry, so this needs no read back
+		unsigned int getNumAlive();
+};
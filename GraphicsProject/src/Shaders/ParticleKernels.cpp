@@ -0,0 +1,52 @@
+#include "ParticleKernels.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define PARTICLES_AVX2
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PARTICLES_SSE2
+#endif
+
+// a += b*t over n floats, done as wide as possible
+static void multiplyAdd(float* a, const float* b, float t, unsigned int n) {
+	unsigned int i = 0;
+#ifdef PARTICLES_AVX2
+	__m256 t8 = _mm256_set1_ps(t);
+	for (; i + 8 <= n; i += 8) {
+		__m256 sum = _mm256_add_ps(_mm256_loadu_ps(a + i), _mm256_mul_ps(_mm256_loadu_ps(b + i), t8));
+		_mm256_storeu_ps(a + i, sum);
+	}
+#endif
+#ifdef PARTICLES_SSE2
+	__m128 t4 = _mm_set1_ps(t);
+	for (; i + 4 <= n; i += 4) {
+		__m128 sum = _mm_add_ps(_mm_loadu_ps(a + i), _mm_mul_ps(_mm_loadu_ps(b + i), t4));
+		_mm_storeu_ps(a + i, sum);
+	}
+#endif
+	for (; i < n; i++) { a[i] += b[i] * t; }
+}
+
+static void subtract(float* a, float t, unsigned int n) {
+	unsigned int i = 0;
+#ifdef PARTICLES_AVX2
+	__m256 t8 = _mm256_set1_ps(t);
+	for (; i + 8 <= n; i += 8) { _mm256_storeu_ps(a + i, _mm256_sub_ps(_mm256_loadu_ps(a + i), t8)); }
+#endif
+#ifdef PARTICLES_SSE2
+	__m128 t4 = _mm_set1_ps(t);
+	for (; i + 4 <= n; i += 4) { _mm_storeu_ps(a + i, _mm_sub_ps(_mm_loadu_ps(a + i), t4)); }
+#endif
+	for (; i < n; i++) { a[i] -= t; }
+}
+
+void tickParticles(glm::vec4* offsets, glm::vec4* colours, const glm::vec4* velocities,
+	const glm::vec4* fadeRates, float* lives, unsigned int count, float timeElapsed)
+{
+	// the arrays are tightly packed vec4s, so they can be treated as flat float arrays
+	multiplyAdd(&offsets[0].x, &velocities[0].x, timeElapsed, 4 * count);
+	multiplyAdd(&colours[0].x, &fadeRates[0].x, timeElapsed, 4 * count);
+	subtract(lives, timeElapsed, count);
+}
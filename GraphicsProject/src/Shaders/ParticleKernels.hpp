@@ -0,0 +1,7 @@
+#pragma once
+#include <glm/glm.hpp>
+
+// Moves, fades and ages count packed particles. Uses AVX2 or SSE2 when the compiler
+// targets them. velocities must have w = 0 so the size in offsets.w is left alone
+void tickParticles(glm::vec4* offsets, glm::vec4* colours, const glm::vec4* velocities,
+	const glm::vec4* fadeRates, float* lives, unsigned int count, float timeElapsed);
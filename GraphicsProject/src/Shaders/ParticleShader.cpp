@@ -1,51 +1,52 @@
 #include "ParticleShader.hpp"
 #include "../Application/CS488Window.hpp"
 #include "../Application/GlErrorCheck.hpp"
+#include "SceneUniforms.hpp"
+#include "ParticleKernels.hpp"
 
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/io.hpp>
 #include <glm/gtx/string_cast.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <algorithm>
+#include <cfloat>
+#include <cstddef>
 #include <iostream>
 
-Particle::Particle() 
-    : pos(glm::vec3(0)), col(glm::vec4(0)), 
-    fadeRate(glm::vec4(0)), velocity(glm::vec3(0)), life(0), size(0) {}
+// enough particles per job to be worth handing to another thread
+const unsigned int PARTICLES_PER_JOB = 4096;
 
-Particle::Particle(glm::vec3 p, glm::vec4 c, glm::vec4 f, glm::vec3 v, float s, float l) 
-    : pos(p), col(c), fadeRate(f), velocity(v), life(l), size(s) {}
-
-void Particle::tick(float timeElapsed) {
-    if (life > 0) {
-        pos += velocity*timeElapsed;
-        col += fadeRate*timeElapsed;
-        life -= timeElapsed;
-    }
-}
-
-// if particles is dead, set distance to be negative, that way, after sorting, all dead 
-// particles will be put at the end of the buffer
-void Particle::updateCamDistance(glm::vec3 camPos) {
-    if (life <= 0) { camDistance = -1; }
-    else { camDistance = glm::length2(camPos-pos); }
-}
-
-bool Particle::operator<(const Particle& other) const {
-    return camDistance > other.camDistance;
-}
-
-ParticleShader::ParticleShader(unsigned int maxParticles_) : 
-	maxParticles(maxParticles_), isEnabled(true)
+ParticleShader::ParticleShader(unsigned int maxParticles_, JobSystem* jobSystem_) : 
+	maxParticles(maxParticles_), jobSystem(jobSystem_), numParticles(0), numDropped(0), sortMode(ParticleSortMode::Radix),
+	transparencyMode(TransparencyMode::Sorted),
+	instanceStream(GL_ARRAY_BUFFER, 2 * maxParticles_ * sizeof(glm::vec4) + STREAM_ALIGNMENT),
+	backend(ParticleBackend::Cpu), isEnabled(true)
 {
-    particles.resize(maxParticles);
-    tempColours.resize(maxParticles);
-    tempOffsets.resize(maxParticles);
+    offsets.resize(maxParticles);
+    colours.resize(maxParticles);
+    velocities.resize(maxParticles);
+    fadeRates.resize(maxParticles);
+    lives.resize(maxParticles);
+    scratchOffsets.resize(maxParticles);
+    scratchColours.resize(maxParticles);
+    scratchVelocities.resize(maxParticles);
+    scratchFadeRates.resize(maxParticles);
+    scratchLives.resize(maxParticles);
+    tempDistances.resize(maxParticles);
+    sortEntries.reserve(maxParticles);
 
     generateProgramObject();
 	attachVertexShader( "Particle.vs" );
 	attachFragmentShader("Particle.fs" );
 	link();
+	bindUniformBlock("Camera", CAMERA_BLOCK_BINDING);
+	oitPassUniform = getUniformHandle("oitPass");
+
+    feedback = new ParticleFeedback(maxParticles);
+}
+
+ParticleShader::~ParticleShader() {
+    delete feedback;
 }
 
 void ParticleShader::initData() {
@@ -58,103 +59,243 @@ void ParticleShader::initData() {
     };
     glGenVertexArrays(1, &vao);
 	glBindVertexArray(vao);
-	GLuint vbo_particle;
-	glGenBuffers( 1, &vbo_particle);
-    glBindBuffer( GL_ARRAY_BUFFER, vbo_particle);
+	glGenBuffers( 1, &vbo_quad);
+    glBindBuffer( GL_ARRAY_BUFFER, vbo_quad);
     glBufferData( GL_ARRAY_BUFFER, sizeof(g_vertex_buffer_data), g_vertex_buffer_data, GL_STATIC_DRAW );
     GLint posLocation = getAttribLocation("pos");
     glEnableVertexAttribArray(posLocation);
     glVertexAttribPointer(posLocation, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
 
-    // VBO for offset+size
-    glGenBuffers(1, &vbo_positions);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo_positions);
-    GLint offsetLocation = getAttribLocation("offset");
+    // offset+size and color, the pointers are set when the frame's ranges are known
+    instanceStream.initData();
+    offsetLocation = getAttribLocation("offset");
     glEnableVertexAttribArray(offsetLocation);
-    glVertexAttribPointer(offsetLocation, 4, GL_FLOAT, GL_FALSE, 0, (void*)0);
     glVertexAttribDivisor(offsetLocation, 1);
-    CHECK_GL_ERRORS;
-
-    // VBO for color
-    glGenBuffers(1, &vbo_colors);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo_colors);
-    GLint colorLocation = getAttribLocation("color");
+    colorLocation = getAttribLocation("color");
     glEnableVertexAttribArray(colorLocation);
-    glVertexAttribPointer(colorLocation, 4, GL_FLOAT, GL_FALSE, 0, (void*)0);
 	glVertexAttribDivisor(colorLocation, 1);
     CHECK_GL_ERRORS;
 
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-}
+    // the GPU backend reads offsets and colours straight out of its state buffers
+    feedback->initData();
+    glGenVertexArrays(2, feedbackVaos);
+    for (int i=0; i<2; i++) {
+        glBindVertexArray(feedbackVaos[i]);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo_quad);
+        glEnableVertexAttribArray(posLocation);
+        glVertexAttribPointer(posLocation, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
 
-// these we should not expect to change anytime soon
-void ParticleShader::loadUniforms(glm::mat4& P) {
-    enable();
-    {
-        // Perspective matrix
-        glUniformMatrix4fv(getUniformLocation("Perspective"), 1, GL_FALSE, value_ptr(P));
-        CHECK_GL_ERRORS;
+        glBindBuffer(GL_ARRAY_BUFFER, feedback->getStateBuffer(i));
+        glEnableVertexAttribArray(offsetLocation);
+        glVertexAttribPointer(offsetLocation, 4, GL_FLOAT, GL_FALSE, sizeof(ParticleGpuState),
+            (void*)offsetof(ParticleGpuState, offset));
+        glVertexAttribDivisor(offsetLocation, 1);
+        glEnableVertexAttribArray(colorLocation);
+        glVertexAttribPointer(colorLocation, 4, GL_FLOAT, GL_FALSE, sizeof(ParticleGpuState),
+            (void*)offsetof(ParticleGpuState, colour));
+        glVertexAttribDivisor(colorLocation, 1);
     }
-    disable();
+    CHECK_GL_ERRORS;
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
 void ParticleShader::tick(float timeElapsed) {
-    for (int i=0; i<maxParticles; i++) {
-        particles[i].tick(timeElapsed);
+    if (backend == ParticleBackend::TransformFeedback) {
+        feedback->tick(timeElapsed);
+        return;
+    }
+    // everything in the packed range is alive, so the update needs no checks.
+    // particles are independent, so each job takes a chunk of the range
+    jobSystem->parallelFor(numParticles, PARTICLES_PER_JOB, [&](unsigned int begin, unsigned int end) {
+        tickParticles(&offsets[begin], &colours[begin], &velocities[begin], &fadeRates[begin],
+            &lives[begin], end-begin, timeElapsed);
+    });
+    for (unsigned int i=0; i<numParticles;) {
+        // a dead particle is replaced by the last one, so check the slot again
+        if (lives[i] <= 0) { removeParticle(i); }
+        else { i++; }
     }
 }
 
+void ParticleShader::removeParticle(unsigned int i) {
+    unsigned int last = numParticles-1;
+    offsets[i] = offsets[last];
+    colours[i] = colours[last];
+    velocities[i] = velocities[last];
+    fadeRates[i] = fadeRates[last];
+    lives[i] = lives[last];
+    numParticles--;
+}
+
 void ParticleShader::addParticle(glm::vec3 p, glm::vec4 c, glm::vec4 f, glm::vec3 v, float s, float l) {
+    if (!isEnabled || l <= 0) { return; }
+    if (backend == ParticleBackend::TransformFeedback) {
+        if (!feedback->addParticle({ p, c, f, v, s, l })) { numDropped++; }
+        return;
+    }
     // reached max particles, do not spawn another
-    if (!isEnabled || newParticleIndex < 0 || particles[newParticleIndex].life > 0) { return; }
-    // otherwise, add a particle
-    particles[newParticleIndex] = Particle(p, c, f, v, s, l);
-    newParticleIndex--;
+    if (numParticles >= maxParticles) {
+        numDropped++;
+        return;
+    }
+    // otherwise, add a particle, it is sorted into place on the next draw
+    offsets[numParticles] = glm::vec4(p, s);
+    colours[numParticles] = c;
+    velocities[numParticles] = glm::vec4(v, 0);
+    fadeRates[numParticles] = f;
+    lives[numParticles] = l;
+    numParticles++;
+}
+
+void ParticleShader::addParticles(const std::vector<ParticleSpawn>& spawns) {
+    for (const ParticleSpawn& p : spawns) {
+        addParticle(p.pos, p.colour, p.fadeRate, p.velocity, p.size, p.life);
+    }
+}
+
+void ParticleShader::sortParticles(glm::vec3 viewPos) {
+    // quantize the distances over the range of this frame
+    float nearest = FLT_MAX;
+    float farthest = 0;
+    for (unsigned int i=0; i<numParticles; i++) {
+        float dist = glm::length(viewPos-glm::vec3(offsets[i]));
+        tempDistances[i] = dist;
+        nearest = std::min(nearest, dist);
+        farthest = std::max(farthest, dist);
+    }
+    // the pool is still in last frame's order, apart from particles added or moved since
+    sortEntries.resize(numParticles);
+    for (unsigned int i=0; i<numParticles; i++) {
+        sortEntries[i].key = quantizeParticleDepth(tempDistances[i], nearest, farthest);
+        sortEntries[i].index = i;
+    }
+
+    if (sortMode == ParticleSortMode::Incremental) { insertionSortParticles(sortEntries); }
+    else { radixSortParticles(sortEntries, sortScratch); }
+
+    // gather the pool into draw order
+    for (unsigned int i=0; i<numParticles; i++) {
+        unsigned int from = sortEntries[i].index;
+        scratchOffsets[i] = offsets[from];
+        scratchColours[i] = colours[from];
+        scratchVelocities[i] = velocities[from];
+        scratchFadeRates[i] = fadeRates[from];
+        scratchLives[i] = lives[from];
+    }
+    offsets.swap(scratchOffsets);
+    colours.swap(scratchColours);
+    velocities.swap(scratchVelocities);
+    fadeRates.swap(scratchFadeRates);
+    lives.swap(scratchLives);
 }
 
-void ParticleShader::drawScene(glm::mat4 V, glm::vec3 viewPos) {
+void ParticleShader::drawScene(glm::vec3 viewPos) {
 	// leave early if not enabled
 	if (!isEnabled) { return;  }
-	// sort all particles and count the number of live particles
-    for (int i=0; i<maxParticles; i++) { particles[i].updateCamDistance(viewPos);}
-    std::sort(particles.begin(), particles.end());
-    // reset the index now that particles are sorted so that all free space is at the end
-    newParticleIndex = maxParticles-1;
-    // copy offsets and colours into temp buffer so we can copy to vbo
-    int numParticles = 0;
-    for (; numParticles<maxParticles && particles[numParticles].life > 0; numParticles++) {
-        tempOffsets[numParticles] = glm::vec4(
-            particles[numParticles].pos, particles[numParticles].size);
-        tempColours[numParticles] = particles[numParticles].col;
+    if (backend == ParticleBackend::TransformFeedback) {
+        drawFeedbackParticles();
+        return;
     }
-    
     if (numParticles == 0) { return; }                   // if no particles, end early
-    // draw the actual particles
+    bool isWeighted = transparencyMode == TransparencyMode::WeightedBlended;
+	// only the live particles are sorted, back to front
+    if (!isWeighted) { sortParticles(viewPos); }
+
+    // draw the actual particles, the transparency pass sets its own blending
 	glBindVertexArray(vao);
     enable();
     {
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE);
-        GLint location = getUniformLocation("View");
-        glUniformMatrix4fv(location, 1, GL_FALSE, value_ptr(V));
-        location = getUniformLocation("viewPos");
-        glUniform3fv(location, 1, value_ptr(viewPos));
-        CHECK_GL_ERRORS;
+        setUniform(oitPassUniform, isWeighted ? 1 : 0);
+        if (!isWeighted) { glBlendFunc(GL_SRC_ALPHA, GL_ONE); }
 
-        glBindBuffer(GL_ARRAY_BUFFER, vbo_positions);
-        glBufferData(GL_ARRAY_BUFFER, 
-            numParticles * sizeof(glm::vec4), &tempOffsets[0], GL_STATIC_DRAW);
-        glBindBuffer(GL_ARRAY_BUFFER, vbo_colors);
-        glBufferData(GL_ARRAY_BUFFER, 
-            numParticles * sizeof(glm::vec4), &tempColours[0], GL_STATIC_DRAW);            
+        size_t offsetsStart = instanceStream.upload(offsets.data(), numParticles * sizeof(glm::vec4));
+        size_t coloursStart = instanceStream.upload(colours.data(), numParticles * sizeof(glm::vec4));
+        glBindBuffer(GL_ARRAY_BUFFER, instanceStream.getBuffer());
+        glVertexAttribPointer(offsetLocation, 4, GL_FLOAT, GL_FALSE, 0, (void*)offsetsStart);
+        glVertexAttribPointer(colorLocation, 4, GL_FLOAT, GL_FALSE, 0, (void*)coloursStart);
         glBindBuffer(GL_ARRAY_BUFFER, 0);
 
         glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, numParticles); 
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        if (!isWeighted) { glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA); }
     }
     disable();
     glBindVertexArray(0);
 }
 
+void ParticleShader::drawFeedbackParticles() {
+    // dead particles have no size, so every slot can be drawn without knowing which are alive.
+    // they are not sorted, the blending is additive so the order only matters for depth writes
+    bool isWeighted = transparencyMode == TransparencyMode::WeightedBlended;
+	glBindVertexArray(feedbackVaos[feedback->getCurrentBuffer()]);
+    enable();
+    {
+        setUniform(oitPassUniform, isWeighted ? 1 : 0);
+        if (!isWeighted) {
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+            glDepthMask(GL_FALSE);
+        }
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, maxParticles);
+        if (!isWeighted) {
+            glDepthMask(GL_TRUE);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        }
+    }
+    disable();
+    glBindVertexArray(0);
+    CHECK_GL_ERRORS;
+}
+
+void ParticleShader::getLiveParticles(std::vector<ParticleGpuState>& result) {
+    result.clear();
+    if (backend == ParticleBackend::TransformFeedback) {
+        std::vector<ParticleGpuState> states(maxParticles);
+        glBindBuffer(GL_ARRAY_BUFFER, feedback->getStateBuffer(feedback->getCurrentBuffer()));
+        glGetBufferSubData(GL_ARRAY_BUFFER, 0, maxParticles * sizeof(ParticleGpuState), states.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        CHECK_GL_ERRORS;
+        for (const ParticleGpuState& s : states) {
+            if (s.velocity.w > 0) { result.push_back(s); }
+        }
+        return;
+    }
+    for (unsigned int i=0; i<numParticles; i++) {
+        ParticleGpuState s;
+        s.offset = offsets[i];
+        s.colour = colours[i];
+        s.velocity = glm::vec4(glm::vec3(velocities[i]), lives[i]);
+        s.fadeRate = fadeRates[i];
+        result.push_back(s);
+    }
+}
+
+unsigned int ParticleShader::getNumParticles() {
+    if (backend == ParticleBackend::TransformFeedback) { return feedback->getNumAlive(); }
+    return numParticles;
+}
+
+unsigned int ParticleShader::getMaxParticles() { return maxParticles; }
+
+unsigned int ParticleShader::getNumDropped() { return numDropped; }
+
 bool ParticleShader::getIsEnabled() { return isEnabled; }
 
-void ParticleShader::setIsEnabled(bool b) { isEnabled = b; }
\ No newline at end of file
+void ParticleShader::setIsEnabled(bool b) { isEnabled = b; }
+
+ParticleSortMode ParticleShader::getSortMode() { return sortMode; }
+
+void ParticleShader::setSortMode(ParticleSortMode mode) { sortMode = mode; }
+
+TransparencyMode ParticleShader::getTransparencyMode() { return transparencyMode; }
+
+void ParticleShader::setTransparencyMode(TransparencyMode mode) { transparencyMode = mode; }
+
+ParticleBackend ParticleShader::getBackend() { return backend; }
+
+void ParticleShader::setBackend(ParticleBackend b) {
+    if (b == backend) { return; }
+    backend = b;
+    numParticles = 0;
+    feedback->clear();
+}
\ No newline at end of file
@@ -1,49 +1,106 @@
 #pragma once
 #include "ShaderProgram.hpp"
+#include "ParticleSort.hpp"
+#include "ParticleFeedback.hpp"
+#include "StreamBuffer.hpp"
+#include "TransparencyPass.hpp"
+#include "../Application/JobSystem.hpp"
 #include <glm/glm.hpp>
 #include <vector>
 
-class Particle {
-    public:
-        Particle();
-        Particle(glm::vec3 p, glm::vec4 c, glm::vec4 f, glm::vec3 v, float s, float l);
-        
-		glm::vec3 pos;
-        glm::vec4 col;
-        glm::vec4 fadeRate;
-        glm::vec3 velocity;
-        float size;
-        float life;
-        
-        void tick(float timeElapsed);
-        
-        float camDistance;								// usedForSorting
-        void updateCamDistance(glm::vec3 camPos);
-        bool operator<(const Particle& other) const;	// sort by distance
+// a particle waiting to be added, emitters fill these from jobs
+struct ParticleSpawn {
+	glm::vec3 pos;
+	glm::vec4 colour;
+	glm::vec4 fadeRate;
+	glm::vec3 velocity;
+	float size;
+	float life;
+};
+
+enum class ParticleSortMode {
+	Radix,			// full sort of the live particles every frame
+	Incremental		// insertion sort starting from last frame's order
+};
+
+enum class ParticleBackend {
+	Cpu,				// simulated, sorted and uploaded by the CPU
+	TransformFeedback	// simulated on the GPU, the CPU only uploads new particles
 };
 
 // particle manager and particle shader
 class ParticleShader : public ShaderProgram {
     unsigned int maxParticles;
-    std::vector<Particle> particles;
-    std::vector<glm::vec4> tempOffsets;
-    std::vector<glm::vec4> tempColours;
-    int newParticleIndex;                   // used for faster addition of new particles
+    JobSystem* jobSystem;
+    // the pool, one array per attribute. live particles are packed at the front,
+    // and offsets and colours are laid out the same as their instance buffers
+    unsigned int numParticles;
+    unsigned int numDropped;                // spawns that found the pool full
+    std::vector<glm::vec4> offsets;         // position and size
+    std::vector<glm::vec4> colours;
+    std::vector<glm::vec4> velocities;      // w is always 0
+    std::vector<glm::vec4> fadeRates;
+    std::vector<float> lives;
+
+    // the pool is rearranged into draw order after sorting,
+    // so it also holds last frame's order for the incremental sort
+    std::vector<glm::vec4> scratchOffsets;
+    std::vector<glm::vec4> scratchColours;
+    std::vector<glm::vec4> scratchVelocities;
+    std::vector<glm::vec4> scratchFadeRates;
+    std::vector<float> scratchLives;
+    std::vector<float> tempDistances;
+    std::vector<ParticleSortEntry> sortEntries;
+    std::vector<ParticleSortEntry> sortScratch;
+    ParticleSortMode sortMode;
+    // weighted blended particles need no sorting
+    TransparencyMode transparencyMode;
+    UniformHandle oitPassUniform;
+
+    // swaps the last live particle into the slot
+    void removeParticle(unsigned int i);
+    void sortParticles(glm::vec3 viewPos);
 
     GLuint vao;
-    GLuint vbo_positions;
-    GLuint vbo_colors;
+    GLuint vbo_quad;
+    // offsets and colours are streamed in every frame, one range each
+    StreamBuffer instanceStream;
+    GLint offsetLocation;
+    GLint colorLocation;
+
+    // the GPU backend, drawn straight from its state buffers
+    ParticleBackend backend;
+    ParticleFeedback* feedback;
+    GLuint feedbackVaos[2];
+    void drawFeedbackParticles();
 	bool isEnabled;
 
     public:
-        ParticleShader(unsigned int maxParticles_); 
+        ParticleShader(unsigned int maxParticles_, JobSystem* jobSystem_); 
+        ~ParticleShader();
         void initData();
-        void loadUniforms(glm::mat4& P);
 
         void addParticle(glm::vec3 p, glm::vec4 c, glm::vec4 f, glm::vec3 v, float s, float l);
+        void addParticles(const std::vector<ParticleSpawn>& spawns);
         void tick(float timeElapsed);
-        void drawScene(glm::mat4 V, glm::vec3 viewPos);
+        // the view and perspective matrices come from the camera block.
+        // with TransparencyMode::WeightedBlended, call between TransparencyPass::begin and composite
+        void drawScene(glm::vec3 viewPos);
+        // copies out the live particles in no particular order. reads back
+        // the GPU state with TransformFeedback, so only for checking the backends
+        void getLiveParticles(std::vector<ParticleGpuState>& result);
 
+		// live particles, for either backend
+		unsigned int getNumParticles();
+		unsigned int getMaxParticles();
+		unsigned int getNumDropped();
 		bool getIsEnabled();
 		void setIsEnabled(bool b);
+		ParticleSortMode getSortMode();
+		void setSortMode(ParticleSortMode mode);
+		TransparencyMode getTransparencyMode();
+		void setTransparencyMode(TransparencyMode mode);
+		ParticleBackend getBackend();
+		// particles are not carried over to the new backend
+		void setBackend(ParticleBackend b);
 };
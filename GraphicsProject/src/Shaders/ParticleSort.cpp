@@ -0,0 +1,55 @@
+#include "ParticleSort.hpp"
+
+#include <cstddef>
+#include <utility>
+
+const unsigned int MAX_DEPTH_KEY = (1u << PARTICLE_DEPTH_BITS) - 1;
+const int NUM_BUCKETS = 1 << PARTICLE_RADIX_BITS;
+
+unsigned int quantizeParticleDepth(float dist, float nearest, float farthest) {
+	if (farthest <= nearest) { return 0; }
+	float t = (farthest - dist) / (farthest - nearest);
+	if (t <= 0) { return 0; }
+	if (t >= 1) { return MAX_DEPTH_KEY; }
+	return (unsigned int)(t * MAX_DEPTH_KEY);
+}
+
+void radixSortParticles(std::vector<ParticleSortEntry>& entries, std::vector<ParticleSortEntry>& scratch) {
+	size_t n = entries.size();
+	scratch.resize(n);
+	ParticleSortEntry* src = entries.data();
+	ParticleSortEntry* dst = scratch.data();
+
+	for (int shift = 0; shift < PARTICLE_DEPTH_BITS; shift += PARTICLE_RADIX_BITS) {
+		unsigned int counts[NUM_BUCKETS] = {};
+		for (size_t i = 0; i < n; i++) {
+			counts[(src[i].key >> shift) & (NUM_BUCKETS - 1)]++;
+		}
+		// every key has the same digit, this pass would not move anything
+		if (n == 0 || counts[(src[0].key >> shift) & (NUM_BUCKETS - 1)] == n) { continue; }
+
+		unsigned int offsets[NUM_BUCKETS];
+		unsigned int total = 0;
+		for (int b = 0; b < NUM_BUCKETS; b++) {
+			offsets[b] = total;
+			total += counts[b];
+		}
+		for (size_t i = 0; i < n; i++) {
+			dst[offsets[(src[i].key >> shift) & (NUM_BUCKETS - 1)]++] = src[i];
+		}
+		std::swap(src, dst);
+	}
+	// odd number of passes leaves the result in scratch
+	if (src != entries.data()) { entries.swap(scratch); }
+}
+
+void insertionSortParticles(std::vector<ParticleSortEntry>& entries) {
+	for (size_t i = 1; i < entries.size(); i++) {
+		ParticleSortEntry entry = entries[i];
+		size_t j = i;
+		for (; j > 0 && entries[j - 1].key > entry.key; j--) {
+			entries[j] = entries[j - 1];
+		}
+		entries[j] = entry;
+	}
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <vector>
+
+// particles are sorted on this many bits of quantized camera distance
+const int PARTICLE_DEPTH_BITS = 16;
+// bits per radix sort pass
+const int PARTICLE_RADIX_BITS = 8;
+
+// sorting works on these instead of moving the particles around
+struct ParticleSortEntry {
+	unsigned int key;
+	unsigned int index;
+};
+
+// the farthest particle gets the smallest key, so ascending order is back to front
+unsigned int quantizeParticleDepth(float dist, float nearest, float farthest);
+
+// stable LSD radix sort by key, scratch is resized as needed
+void radixSortParticles(std::vector<ParticleSortEntry>& entries, std::vector<ParticleSortEntry>& scratch);
+// stable and close to linear when the entries are nearly sorted, e.g. last frame's order
+void insertionSortParticles(std::vector<ParticleSortEntry>& entries);
@@ -1,31 +1,157 @@
 #include "PickingShader.hpp"
 #include "../Application/GlErrorCheck.hpp"
 #include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/matrix_transform.hpp>
 
-PickingShader::PickingShader(BatchInfoMap* batchInfoMap_)
-    : SceneShader(batchInfoMap_, "Picking.vs", "Picking.fs")
-{}
+// room for this many picking colours per stream region before it has to grow
+const size_t INITIAL_COLOUR_BYTES = 1024 * sizeof(glm::vec3);
+
+PickingShader::PickingShader(BatchInfoMap* batchInfoMap_, float wW, float wH)
+    : SceneShader(batchInfoMap_, "Picking.vs", "Picking.fs"), 
+    windowW(wW), windowH(wH), isSupported(false),
+    pickFBO(0), pickColourBuffer(0), pickDepthBuffer(0), nextPBO(0),
+    colourStream(GL_ARRAY_BUFFER, INITIAL_COLOUR_BYTES), instanceColoursOffset(0)
+{
+    for (int i = 0; i < NUM_PICK_BUFFERS; i++) {
+        pickPBOs[i] = 0;
+        pickFences[i] = 0;
+    }
+}
+
+PickingShader::~PickingShader() {
+    for (int i = 0; i < NUM_PICK_BUFFERS; i++) {
+        if (pickFences[i] != 0) { glDeleteSync(pickFences[i]); }
+    }
+    glDeleteBuffers(NUM_PICK_BUFFERS, pickPBOs);
+    glDeleteFramebuffers(1, &pickFBO);
+    glDeleteRenderbuffers(1, &pickColourBuffer);
+    glDeleteRenderbuffers(1, &pickDepthBuffer);
+}
 
 void PickingShader::initMeshData(const MeshConsolidator & meshConsolidator) {
     SceneShader::initMeshData(meshConsolidator);
+
+    glBindVertexArray(vao_meshData);
+    colourStream.initData();
+    colourAttribLocation = getAttribLocation("colour");
+    glEnableVertexAttribArray(colourAttribLocation);
+    glVertexAttribDivisor(colourAttribLocation, 1);
+    setInstanceOffset(0);
+    glBindVertexArray(0);
+
+    // colour and depth buffers only need to cover the pick region
+    glGenRenderbuffers(1, &pickColourBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, pickColourBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, PICK_SIZE, PICK_SIZE);
+    glGenRenderbuffers(1, &pickDepthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, pickDepthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, PICK_SIZE, PICK_SIZE);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &pickFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, pickFBO);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, pickColourBuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, pickDepthBuffer);
+    isSupported = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // each pixel buffer holds a single RGBA pixel
+    glGenBuffers(NUM_PICK_BUFFERS, pickPBOs);
+    for (int i = 0; i < NUM_PICK_BUFFERS; i++) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pickPBOs[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, 4, nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    CHECK_GL_ERRORS;
+}
+
+void PickingShader::loadInstanceData(SceneStore& store) {
+    SceneShader::loadInstanceData(store);
+
+    //-- picking colour of every instance
+    instanceColours.clear();
+    for (int i : renderQueue.instances) {
+        instanceColours.push_back(idToColour(store.nodes[i]->m_nodeId));
+    }
+    instanceColoursOffset = colourStream.upload(instanceColours.data(), instanceColours.size() * sizeof(glm::vec3));
+    CHECK_GL_ERRORS;
 }
 
-bool PickingShader::loadGeometryNodeData(GeometryNode* geometryNode, glm::mat4& fullT) {
-    //-- picking colour
-    glm::vec3 c = idToColour(geometryNode->m_nodeId);
-    glUniform3fv(getUniformLocation("colour"), 1, value_ptr(c));
-    
-    return SceneShader::loadGeometryNodeData(geometryNode, fullT);
-} 
+void PickingShader::setInstanceOffset(int firstInstance) {
+    SceneShader::setInstanceOffset(firstInstance);
+    glBindBuffer(GL_ARRAY_BUFFER, colourStream.getBuffer());
+    glVertexAttribPointer(colourAttribLocation, 3, GL_FLOAT, GL_FALSE, 0, 
+        (void*)(instanceColoursOffset + firstInstance * sizeof(glm::vec3)));
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
 
 void PickingShader::loadUniforms(glm::mat4& P) {
-    SceneShader::loadUniforms(P);
+    // zoom the projection in so the pick region covers the pixels around the centre of the window
+    glm::mat4 pickP = glm::scale(glm::mat4(1), glm::vec3(windowW / PICK_SIZE, windowH / PICK_SIZE, 1)) * P;
+    SceneShader::loadUniforms(pickP);
 }
 
 void PickingShader::drawScene(Scene* scene, glm::mat4 V, glm::vec3 viewPos) {
     SceneShader::drawScene(scene, V, viewPos);
 }
 
+void PickingShader::requestPick(Scene* scene, glm::mat4 V, glm::vec3 viewPos) {
+    if (!isSupported) { return; }
+    // this buffer is still in flight from a few frames ago, drop that result
+    if (pickFences[nextPBO] != 0) {
+        glDeleteSync(pickFences[nextPBO]);
+        pickFences[nextPBO] = 0;
+    }
+
+    // only shade the centre pixel
+    glBindFramebuffer(GL_FRAMEBUFFER, pickFBO);
+    glViewport(0, 0, PICK_SIZE, PICK_SIZE);
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(PICK_SIZE / 2, PICK_SIZE / 2, 1, 1);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    drawScene(scene, V, viewPos);
+    glDisable(GL_SCISSOR_TEST);
+
+    // copy into the pixel buffer, this returns immediately
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pickPBOs[nextPBO]);
+    glReadPixels(PICK_SIZE / 2, PICK_SIZE / 2, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    pickFences[nextPBO] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    nextPBO = (nextPBO + 1) % NUM_PICK_BUFFERS;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, windowW, windowH);
+    CHECK_GL_ERRORS;
+}
+
+bool PickingShader::pollPickResult(unsigned int& id) {
+    bool found = false;
+    // nextPBO is the oldest request, go from oldest to newest
+    for (int i = 0; i < NUM_PICK_BUFFERS; i++) {
+        int index = (nextPBO + i) % NUM_PICK_BUFFERS;
+        if (pickFences[index] == 0) { continue; }
+        // do not wait, if this one is not done then neither are the newer ones
+        GLenum status = glClientWaitSync(pickFences[index], 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) { break; }
+        glDeleteSync(pickFences[index]);
+        pickFences[index] = 0;
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pickPBOs[index]);
+        GLubyte* pixel = (GLubyte*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, 4, GL_MAP_READ_BIT);
+        if (pixel != nullptr) {
+            id = colourToId(pixel);
+            found = true;
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+    CHECK_GL_ERRORS;
+    return found;
+}
+
+bool PickingShader::getIsSupported() { return isSupported; }
+
 glm::vec3 PickingShader::idToColour(unsigned int id) {
     float r = float(id&0xff) / 255.0f;
     float g = float((id>>8)&0xff) / 255.0f;
@@ -35,4 +161,4 @@ glm::vec3 PickingShader::idToColour(unsigned int id) {
 
 unsigned int PickingShader::colourToId(GLubyte buffer[ 4 ]) {
     return buffer[0] + (buffer[1] << 8) + (buffer[2] << 16);
-}
\ No newline at end of file
+}
@@ -3,16 +3,48 @@
 #include "../Application/MeshConsolidator.hpp"
 #include "../Objects/Scene.hpp"
 
+// picking renders into its own tiny framebuffer centred on the crosshair
+const int PICK_SIZE = 3;
+// read backs in flight, results arrive up to this many frames late
+const int NUM_PICK_BUFFERS = 3;
+
 class PickingShader : public SceneShader {
+    float windowW, windowH;
+    bool isSupported;
+
+    GLuint pickFBO;
+    GLuint pickColourBuffer;
+    GLuint pickDepthBuffer;
+    // ring of pixel buffers so glReadPixels returns without waiting on the GPU
+    GLuint pickPBOs[NUM_PICK_BUFFERS];
+    GLsync pickFences[NUM_PICK_BUFFERS];
+    int nextPBO;
+
+    // the picking colour is a per instance attribute
+    StreamBuffer colourStream;
+    size_t instanceColoursOffset;
+    GLint colourAttribLocation;
+    std::vector<glm::vec3> instanceColours;
+
     protected:
-        bool loadGeometryNodeData(GeometryNode* geometryNode, glm::mat4& fullT) override;
+        virtual void loadInstanceData(SceneStore& store) override;
+        virtual void setInstanceOffset(int firstInstance) override;
 
     public:
         glm::vec3 idToColour(unsigned int id);
         unsigned int colourToId(GLubyte buffer[ 4 ]);
 
-        PickingShader(BatchInfoMap* batchInfoMap_);
+        PickingShader(BatchInfoMap* batchInfoMap_, float wW, float wH);
+        ~PickingShader();
         virtual void initMeshData(const MeshConsolidator& MeshConsolidator) override;
         virtual void loadUniforms(glm::mat4& P) override;
         virtual void drawScene(Scene* scene, glm::mat4 V, glm::vec3 viewPos) override;
-};
\ No newline at end of file
+
+        // draws the pixels under the crosshair and queues an asynchronous read back
+        void requestPick(Scene* scene, glm::mat4 V, glm::vec3 viewPos);
+        // returns true iff a queued read back has finished, with id set to the newest result
+        bool pollPickResult(unsigned int& id);
+
+        // false if the pick framebuffer could not be created
+        bool getIsSupported();
+};
@@ -0,0 +1,77 @@
+#include "RenderQueue.hpp"
+
+#include <algorithm>
+
+bool RenderQueue::SortKey::operator<(const SortKey& other) const {
+	if (startIndex != other.startIndex) { return startIndex < other.startIndex; }
+	if (materialHandle != other.materialHandle) { return materialHandle < other.materialHandle; }
+	return storeIndex < other.storeIndex;
+}
+
+void RenderQueue::addNode(const SceneStore& store, int i) {
+	// deleted since the store was built
+	if (store.nodes[i] == nullptr) { return; }
+	keys.push_back({ store.batches[i].startIndex, store.materialHandles[i], i });
+}
+
+void RenderQueue::build(const SceneStore& store, const Frustum& frustum, OcclusionCuller* occlusion) {
+	keys.clear();
+	cullStats.culled = 0;
+	cullStats.occluded = 0;
+	// depth first, so the nodes of a subtree are i up to subtreeEnds[i]
+	int i = 0;
+	int insideEnd = 0;		// nodes before this are known to be in the frustum
+	while (i < store.size()) {
+		if (store.subtreeGeometryCounts[i] == 0) {
+			i = store.subtreeEnds[i];
+			continue;
+		}
+		if (i >= insideEnd) {
+			FrustumTest test = frustum.testAABB(store.subtreeAABBs[i]);
+			if (test == FrustumTest::Outside) {
+				cullStats.culled += store.subtreeGeometryCounts[i];
+				i = store.subtreeEnds[i];
+				continue;
+			}
+			if (test == FrustumTest::Inside) {
+				// everything under it is in too
+				if (occlusion == nullptr) {
+					for (int j = i; j < store.subtreeEnds[i]; j++) {
+						if (store.isGeometry(j)) { addNode(store, j); }
+					}
+					i = store.subtreeEnds[i];
+					continue;
+				}
+				// still has to go down the subtree for the occlusion tests
+				insideEnd = store.subtreeEnds[i];
+			}
+		}
+		if (occlusion != nullptr && occlusion->isOccluded(store, i)) {
+			cullStats.occluded += store.subtreeGeometryCounts[i];
+			i = store.subtreeEnds[i];
+			continue;
+		}
+		// partly in, test the node by itself then move on to its children
+		if (store.isGeometry(i)) {
+			if (i >= insideEnd && frustum.testAABB(store.worldAABBs[i]) == FrustumTest::Outside) { cullStats.culled++; }
+			else { addNode(store, i); }
+		}
+		i++;
+	}
+	cullStats.visible = keys.size();
+	std::sort(keys.begin(), keys.end());
+
+	buckets.clear();
+	instances.clear();
+	for (int k = 0; k < keys.size(); k++) {
+		int i = keys[k].storeIndex;
+		bool sameBucket = k > 0 && keys[k].startIndex == keys[k - 1].startIndex
+			&& keys[k].materialHandle == keys[k - 1].materialHandle;
+		if (!sameBucket) {
+			GeometryNode* node = static_cast<GeometryNode*>(store.nodes[i]);
+			buckets.push_back({ node, store.batches[i], (int)instances.size(), 0 });
+		}
+		instances.push_back(i);
+		buckets.back().numInstances++;
+	}
+}
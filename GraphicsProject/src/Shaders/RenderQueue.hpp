@@ -0,0 +1,48 @@
+#pragma once
+#include "../Application/BatchInfo.hpp"
+#include "../Objects/GeometryNode.hpp"
+#include "../Objects/SceneStore.hpp"
+#include "../Application/Frustum.hpp"
+#include "../Application/OcclusionCuller.hpp"
+
+#include <vector>
+
+// a group of geometry nodes that share a mesh and a material,
+// so they can be drawn with a single instanced draw call
+struct RenderBucket {
+	GeometryNode* node;			// any node in the bucket, for reading the shared material
+	BatchInfo batch;
+	int firstInstance;			// range into RenderQueue::instances
+	int numInstances;
+};
+
+// how many geometry nodes made it into the queue, how many were outside the frustum
+// and how many were hidden behind occluders
+struct CullStats {
+	int visible;
+	int culled;
+	int occluded;
+};
+
+// Groups the geometry nodes of a scene into buckets by mesh and material
+class RenderQueue {
+	struct SortKey {
+		unsigned int startIndex;	// identifies the mesh
+		int materialHandle;
+		int storeIndex;
+		bool operator<(const SortKey& other) const;
+	};
+	std::vector<SortKey> keys;
+
+	void addNode(const SceneStore& store, int i);
+
+	public:
+		std::vector<RenderBucket> buckets;
+		std::vector<int> instances;		// store indices, contiguous per bucket
+		CullStats cullStats;
+
+		// rebuilds the buckets from the geometry nodes in the store that are in the frustum,
+		// and not hidden if an occlusion culler is given.
+		// subtrees are culled as a whole using their bounds in the store
+		void build(const SceneStore& store, const Frustum& frustum, OcclusionCuller* occlusion = nullptr);
+};
@@ -8,13 +8,21 @@
 #include <string>
 #include <algorithm>
 
-SceneShader::SceneShader(BatchInfoMap* batchInfoMap, std::string vertexShader, std::string fragmentShader)
-    : ShaderProgram(), batchInfoMap(batchInfoMap) 
+// room for this many Model matrices per stream region before it has to grow
+const size_t INITIAL_INSTANCE_BYTES = 1024 * sizeof(glm::mat4);
+
+SceneShader::SceneShader(BatchInfoMap* batchInfoMap, std::string vertexShader, std::string fragmentShader,
+	const ShaderDefines& defines)
+    : ShaderProgram(), instanceStream(GL_ARRAY_BUFFER, INITIAL_INSTANCE_BYTES), instanceModelsOffset(0),
+	batchInfoMap(batchInfoMap), cullProjection(1), occlusionCuller(nullptr)
 {
     generateProgramObject();
+	setDefines(defines);
 	attachVertexShader( vertexShader );
 	attachFragmentShader( fragmentShader );
 	link();
+	viewUniform = hasUniform("View") ? getUniformHandle("View") : -1;
+	perspectiveUniform = hasUniform("Perspective") ? getUniformHandle("Perspective") : -1;
 }
 
 void SceneShader::initMeshData(const MeshConsolidator & meshConsolidator) {
@@ -36,66 +44,85 @@ void SceneShader::initMeshData(const MeshConsolidator & meshConsolidator) {
 	// "position" vertex attribute location for any bound vertex shader program.
 	glVertexAttribPointer(positionAttribLocation, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
 
+	// the Model matrix is a per instance attribute, taking up one location per column
+	instanceStream.initData();
+	modelAttribLocation = getAttribLocation("Model");
+	for (int i = 0; i < 4; i++) {
+		glEnableVertexAttribArray(modelAttribLocation + i);
+		glVertexAttribDivisor(modelAttribLocation + i, 1);
+	}
+	SceneShader::setInstanceOffset(0);
+	CHECK_GL_ERRORS;
+
 	// Restore defaults
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 	glBindVertexArray(0);
 }
 
-bool SceneShader::loadGeometryNodeData(GeometryNode* geometryNode, glm::mat4& fullT) {
-    //-- Set ModelView matrix:
-    GLint location = getUniformLocation("Model");
-    glUniformMatrix4fv(location, 1, GL_FALSE, value_ptr(fullT));
-	CHECK_GL_ERRORS;
+bool SceneShader::loadBucketData(const RenderBucket& /*bucket*/) { return true; }
 
-	return true;
+void SceneShader::loadInstanceData(SceneStore& store) {
+	instanceModels.clear();
+	for (int i : renderQueue.instances) {
+		instanceModels.push_back(store.worldTrans[i]);
+	}
+	instanceModelsOffset = instanceStream.upload(instanceModels.data(), instanceModels.size() * sizeof(glm::mat4));
+	CHECK_GL_ERRORS;
 }
 
-void SceneShader::drawSceneRecursive(glm::mat4 curT, SceneNode* node) {
-    if (node == nullptr) { return; }
-    // update transformation
-	glm::mat4 fullT = curT*node->trans;
-
-    // draw the mesh if it is a geometry node
-    if (node->m_nodeType == NodeType::GeometryNode) {
-		GeometryNode * geometryNode = static_cast<GeometryNode *>(node);
-        enable();
-        { 
-			if (loadGeometryNodeData(geometryNode, fullT)) {
-				// Get the BatchInfo corresponding to the GeometryNode's unique MeshId.
-				BatchInfo batchInfo = (*batchInfoMap)[geometryNode->meshId];
-				glDrawArrays(GL_TRIANGLES, batchInfo.startIndex, batchInfo.numIndices);
-			}
-		}
-		disable();
+// there is no base instance in GL 3.3, so move the attribute pointers instead
+void SceneShader::setInstanceOffset(int firstInstance) {
+	glBindBuffer(GL_ARRAY_BUFFER, instanceStream.getBuffer());
+	size_t offset = instanceModelsOffset + firstInstance * sizeof(glm::mat4);
+	for (int i = 0; i < 4; i++) {
+		glVertexAttribPointer(modelAttribLocation + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
+			(void*)(offset + i * sizeof(glm::vec4)));
 	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
 
-    // iterate through the tree
-    for (SceneNode* child : node->children) {
-        drawSceneRecursive(fullT, child);
-    }
+void SceneShader::drawInstanced(const BatchInfo& batch, int firstInstance, int numInstances) {
+	setInstanceOffset(firstInstance);
+	glDrawArraysInstanced(GL_TRIANGLES, batch.startIndex, batch.numIndices, numInstances);
+	CHECK_GL_ERRORS;
 }
 
 void SceneShader::loadUniforms(glm::mat4& P) {
+    cullProjection = P;
     enable();
     {
         // Perspective matrix
-        glUniformMatrix4fv(getUniformLocation("Perspective"), 1, GL_FALSE, value_ptr(P));
+        if (perspectiveUniform >= 0) { setUniform(perspectiveUniform, P); }
         CHECK_GL_ERRORS;
     }
     disable();
 }
 
 void SceneShader::drawScene(Scene* scene, glm::mat4 V, glm::vec3 viewPos) {    
+    // group the nodes in view by mesh and material,
+    // world transforms and bounds are kept up to date by Scene::updateGlobalPos
+    SceneStore& store = scene->getStore();
+    OcclusionCuller* occlusion = occlusionCuller != nullptr && occlusionCuller->getIsEnabled() ? occlusionCuller : nullptr;
+    renderQueue.build(store, Frustum(cullProjection * V), occlusion);
+
+    glBindVertexArray(vao_meshData);
     enable();
     {
         // view matrix
-        glUniformMatrix4fv(getUniformLocation("View"), 1, GL_FALSE, value_ptr(V));
+        if (viewUniform >= 0) { setUniform(viewUniform, V); }
         CHECK_GL_ERRORS;
+
+        loadInstanceData(store);
+        for (const RenderBucket& bucket : renderQueue.buckets) {
+            if (loadBucketData(bucket)) {
+                drawInstanced(bucket.batch, bucket.firstInstance, bucket.numInstances);
+            }
+        }
     }
     disable();
-
-    glBindVertexArray(vao_meshData);
-    drawSceneRecursive(glm::mat4(1.0), scene->getRoot());
     glBindVertexArray(0);
 }
 
+void SceneShader::setOcclusionCuller(OcclusionCuller* culler) { occlusionCuller = culler; }
+
+const CullStats& SceneShader::getCullStats() { return renderQueue.cullStats; }
@@ -1,22 +1,50 @@
 #pragma once
 #include "ShaderProgram.hpp"
+#include "RenderQueue.hpp"
+#include "StreamBuffer.hpp"
 #include "../Application/MeshConsolidator.hpp"
 #include "../Objects/Scene.hpp"
 
-// Base class of all shaders that require drawing the scene tree
-class SceneShader : public ShaderProgram {
-	// helper function
-    void drawSceneRecursive(glm::mat4 curT, SceneNode* node);
+#include <vector>
 
+// Base class of all shaders that require drawing the scene tree.
+// Geometry is drawn one bucket at a time with instancing, the Model
+// matrix of each instance is a per instance vertex attribute
+class SceneShader : public ShaderProgram {
     protected:
 		GLuint vao_meshData;
+		StreamBuffer instanceStream;
+		size_t instanceModelsOffset;		// where this frame's Model matrices start in the stream
+		GLint modelAttribLocation;
 		BatchInfoMap* batchInfoMap;
-		// returns true iff the geometry node should be rendered
-        virtual bool loadGeometryNodeData(GeometryNode* geometryNode, glm::mat4& fullT);
+		// -1 if the program reads them from the camera block instead
+		UniformHandle viewUniform;
+		UniformHandle perspectiveUniform;
+
+		glm::mat4 cullProjection;			// the projection from loadUniforms, for the frustum
+		OcclusionCuller* occlusionCuller;	// nullptr if this pass does not use it
+		RenderQueue renderQueue;
+		std::vector<glm::mat4> instanceModels;	// Model matrices, same order as renderQueue.instances
+
+		// returns true iff the bucket should be rendered, sets any uniforms shared by the bucket
+        virtual bool loadBucketData(const RenderBucket& bucket);
+		// uploads the per instance attributes of the whole queue
+		virtual void loadInstanceData(SceneStore& store);
+		// points the per instance attributes at the given instance
+		virtual void setInstanceOffset(int firstInstance);
+		// draws numInstances copies of the batch, starting at firstInstance
+		void drawInstanced(const BatchInfo& batch, int firstInstance, int numInstances);
 
     public:
-        SceneShader(BatchInfoMap* batchInfoMap, std::string vertexShader, std::string fragmentShader);
+        SceneShader(BatchInfoMap* batchInfoMap, std::string vertexShader, std::string fragmentShader,
+			const ShaderDefines& defines = ShaderDefines());
         virtual void initMeshData(const MeshConsolidator& MeshConsolidator);
         virtual void loadUniforms(glm::mat4& P);
         virtual void drawScene(Scene* scene, glm::mat4 V, glm::vec3 viewPos);
-};
\ No newline at end of file
+
+		// the culler must have been updated with the camera this shader draws with
+		void setOcclusionCuller(OcclusionCuller* culler);
+
+		// what the last drawScene drew and culled
+		const CullStats& getCullStats();
+};
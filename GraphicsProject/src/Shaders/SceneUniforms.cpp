@@ -0,0 +1,106 @@
+#include "SceneUniforms.hpp"
+#include "../Application/GlErrorCheck.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cstring>
+
+// offsets given by the std140 rules
+static_assert(sizeof(LightBlockHeader) == 144, "LightBlockHeader does not match the Lights block");
+static_assert(sizeof(PointLightStd140) == 48, "PointLightStd140 does not match LightSource");
+static_assert(sizeof(LanternBlockHeader) == 16, "LanternBlockHeader does not match the Lanterns block");
+static_assert(sizeof(LanternStd140) == 32, "LanternStd140 does not match Lantern");
+
+SceneUniforms::SceneUniforms(int maxPointLights_, int maxLanterns_)
+	: maxPointLights(maxPointLights_), maxLanterns(maxLanterns_) {}
+
+void SceneUniforms::initData() {
+	lightData.resize(sizeof(LightBlockHeader) + maxPointLights * sizeof(PointLightStd140));
+	lanternData.resize(sizeof(LanternBlockHeader) + maxLanterns * sizeof(LanternStd140));
+
+	glGenBuffers(1, &cameraUBO);
+	glBindBuffer(GL_UNIFORM_BUFFER, cameraUBO);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(CameraBlock), nullptr, GL_DYNAMIC_DRAW);
+	glGenBuffers(1, &lightUBO);
+	glBindBuffer(GL_UNIFORM_BUFFER, lightUBO);
+	glBufferData(GL_UNIFORM_BUFFER, lightData.size(), nullptr, GL_DYNAMIC_DRAW);
+	glGenBuffers(1, &lanternUBO);
+	glBindBuffer(GL_UNIFORM_BUFFER, lanternUBO);
+	glBufferData(GL_UNIFORM_BUFFER, lanternData.size(), nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	// the binding points never change, programs only need to point their blocks at them
+	glBindBufferBase(GL_UNIFORM_BUFFER, CAMERA_BLOCK_BINDING, cameraUBO);
+	glBindBufferBase(GL_UNIFORM_BUFFER, LIGHT_BLOCK_BINDING, lightUBO);
+	glBindBufferBase(GL_UNIFORM_BUFFER, LANTERN_BLOCK_BINDING, lanternUBO);
+	CHECK_GL_ERRORS;
+
+	clusters.initData();
+}
+
+void SceneUniforms::uploadBlock(GLuint ubo, const void* data, size_t size) {
+	glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, size, data);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	CHECK_GL_ERRORS;
+}
+
+void SceneUniforms::updateCamera(glm::mat4 V, glm::mat4 P, glm::vec3 viewPos) {
+	view = V;
+	perspective = P;
+	CameraBlock camera = { V, P, glm::vec4(viewPos, 1) };
+	uploadBlock(cameraUBO, &camera, sizeof(CameraBlock));
+}
+
+void SceneUniforms::updateLights(Scene* scene, ShadowShader* shadowShader, glm::vec3 viewPos) {
+	// directional light and shadow map calculations
+	DirectionalLight dlight = scene->getDirectionalLight();
+	glm::vec3 dirLightPos = shadowShader->getDirLightPosition(viewPos, dlight.direction);
+	glm::mat4 dirLightView = glm::lookAt(dirLightPos, viewPos, glm::vec3(0, 1, 0));
+	glm::mat4 dirLightProjection = shadowShader->getDirLightPerspectiveMatrix();
+
+	std::vector<PointLight*> lights = scene->getPointLights();
+	LightBlockHeader* header = (LightBlockHeader*)lightData.data();
+	header->dirLightDirection = glm::vec4(dlight.direction, 0);
+	header->dirLightIntensity = glm::vec4(dlight.rgbIntensity, 0);
+	header->dirLightPos = dirLightPos;
+	header->numPointLights = std::min(maxPointLights, (int)lights.size());
+	header->dirLightSpaceMatrix = dirLightProjection*dirLightView;
+	PointLightStd140* pointLights = (PointLightStd140*)(lightData.data() + sizeof(LightBlockHeader));
+	for (int i = 0; i < header->numPointLights; i++) {
+		pointLights[i].position = glm::vec4(lights[i]->position, 1);
+		pointLights[i].rgbIntensity = glm::vec4(lights[i]->rgbIntensity, 0);
+		pointLights[i].attenuationVals = glm::vec4(lights[i]->attenuationVals, 0);
+	}
+
+	// lantern regions of influence
+	std::vector<Lantern*> lanterns = scene->getLanterns();
+	LanternBlockHeader* lanternHeader = (LanternBlockHeader*)lanternData.data();
+	lanternHeader->numLanterns = std::min(maxLanterns, (int)lanterns.size());
+	LanternStd140* lanternArray = (LanternStd140*)(lanternData.data() + sizeof(LanternBlockHeader));
+	for (int i = 0; i < lanternHeader->numLanterns; i++) {
+		lanternArray[i].position = lanterns[i]->getLightGlobalPos();
+		lanternArray[i].radius = lanterns[i]->getRadius();
+		lanternArray[i].lanternType = lanterns[i]->getFlame().id;
+	}
+	size_t lanternSize = sizeof(LanternBlockHeader) + lanternHeader->numLanterns * sizeof(LanternStd140);
+	uploadBlock(lanternUBO, lanternData.data(), lanternSize);
+
+	// only the lights and lanterns overlapping a fragment's cluster are shaded
+	clusters.update(view, perspective, lights, header->numPointLights, lanterns, lanternHeader->numLanterns);
+	header->clusterDims = clusters.getDims();
+	header->clusterDepth = clusters.getDepthParams();
+	size_t lightSize = sizeof(LightBlockHeader) + header->numPointLights * sizeof(PointLightStd140);
+	uploadBlock(lightUBO, lightData.data(), lightSize);
+}
+
+ShaderDefines SceneUniforms::getDefines() {
+	return {
+		{ "NR_POINT_LIGHTS", maxPointLights },
+		{ "NR_LANTERNS", maxLanterns }
+	};
+}
+
+int SceneUniforms::getMaxPointLights() { return maxPointLights; }
+int SceneUniforms::getMaxLanterns() { return maxLanterns; }
+LightClusters& SceneUniforms::getClusters() { return clusters; }
@@ -0,0 +1,85 @@
+#pragma once
+#include "ShadowShader.hpp"
+#include "LightClusters.hpp"
+#include "../Objects/Scene.hpp"
+#include "../OpenGLImport.hpp"
+
+#include <glm/glm.hpp>
+#include <vector>
+
+// binding points shared by every program that uses the blocks
+const GLuint CAMERA_BLOCK_BINDING = 0;
+const GLuint LIGHT_BLOCK_BINDING = 1;
+const GLuint LANTERN_BLOCK_BINDING = 2;
+
+// std140 mirrors of the blocks declared in the shaders,
+// make sure these line up with Phong.fs
+struct CameraBlock {
+	glm::mat4 view;
+	glm::mat4 perspective;
+	glm::vec4 viewPosition;
+};
+
+struct LightBlockHeader {
+	glm::vec4 dirLightDirection;
+	glm::vec4 dirLightIntensity;
+	glm::vec3 dirLightPos;
+	int numPointLights;
+	glm::mat4 dirLightSpaceMatrix;
+	glm::ivec4 clusterDims;
+	glm::vec4 clusterDepth;
+};
+
+struct PointLightStd140 {
+	glm::vec4 position;
+	glm::vec4 rgbIntensity;
+	glm::vec4 attenuationVals;
+};
+
+struct LanternBlockHeader {
+	int numLanterns;
+	int padding[3];
+};
+
+struct LanternStd140 {
+	glm::vec3 position;
+	float radius;
+	int lanternType;
+	int padding[3];
+};
+
+// Uniform buffers for the camera, lights and lanterns. They are filled once
+// per frame and shared by every pass, instead of each program setting its own uniforms
+class SceneUniforms {
+	int maxPointLights;
+	int maxLanterns;
+
+	GLuint cameraUBO;
+	GLuint lightUBO;
+	GLuint lanternUBO;
+
+	// staging memory for the variable sized blocks
+	std::vector<unsigned char> lightData;
+	std::vector<unsigned char> lanternData;
+
+	// the camera the lights are clustered for
+	glm::mat4 view;
+	glm::mat4 perspective;
+	LightClusters clusters;
+
+	void uploadBlock(GLuint ubo, const void* data, size_t size);
+
+	public:
+		SceneUniforms(int maxPointLights, int maxLanterns);
+		void initData();
+
+		// camera is updated separately, as some passes draw from another view
+		void updateCamera(glm::mat4 V, glm::mat4 P, glm::vec3 viewPos);
+		void updateLights(Scene* scene, ShadowShader* shadowShader, glm::vec3 viewPos);
+
+		// defines the array sizes in the shaders that use the blocks
+		ShaderDefines getDefines();
+		int getMaxPointLights();
+		int getMaxLanterns();
+		LightClusters& getClusters();
+};
@@ -36,6 +36,14 @@ void ShaderProgram::generateProgramObject() {
     }
 }
 
+//------------------------------------------------------------------------------------
+void ShaderProgram::setDefines(const ShaderDefines & defines) {
+    defineLines = "";
+    for (const auto & define : defines) {
+        defineLines += "#define " + define.first + " " + to_string(define.second) + "\n";
+    }
+}
+
 //------------------------------------------------------------------------------------
 void ShaderProgram::attachVertexShader (
 		std::string filePath
@@ -79,14 +87,29 @@ void ShaderProgram::extractSourceCodeAndCompile (
     string shaderSourceCode;
     extractSourceCode(shaderSourceCode, shader.filePath);
 
+    // defines have to come after the #version line
+    if (!defineLines.empty()) {
+        size_t versionEnd = shaderSourceCode.find('\n') + 1;
+        shaderSourceCode.insert(versionEnd, defineLines);
+    }
+
     compileShader(shader.shaderObject, shaderSourceCode);
 }
 
 //------------------------------------------------------------------------------------
 void ShaderProgram::recompileShaders() {
-    extractSourceCodeAndCompile(vertexShader);
-    extractSourceCodeAndCompile(fragmentShader);
-    extractSourceCodeAndCompile(geometryShader);
+    if (vertexShader.shaderObject != 0) { extractSourceCodeAndCompile(vertexShader); }
+    if (fragmentShader.shaderObject != 0) { extractSourceCodeAndCompile(fragmentShader); }
+    if (geometryShader.shaderObject != 0) { extractSourceCodeAndCompile(geometryShader); }
+
+    // uniform locations may have moved, so relink and refill the cache
+    glLinkProgram(programObject);
+    checkLinkStatus();
+    cacheUniformLocations();
+    for (const pair<string, GLuint> & binding : blockBindings) {
+        applyUniformBlockBinding(binding.first.c_str(), binding.second);
+    }
+    CHECK_GL_ERRORS;
 }
 
 //------------------------------------------------------------------------------------
@@ -126,6 +149,13 @@ void ShaderProgram::extractSourceCode (
 * Links all attached shaders within the ShaderProgram.
 * Note: This method must be called once before calling ShaderProgram::enable().
 */
+void ShaderProgram::setTransformFeedbackVaryings(const std::vector<const char *> & varyings) {
+    // kept by the program object, so it also applies when relinking
+    glTransformFeedbackVaryings(programObject, varyings.size(), varyings.data(), GL_INTERLEAVED_ATTRIBS);
+    CHECK_GL_ERRORS;
+}
+
+//------------------------------------------------------------------------------------
 void ShaderProgram::link() {
     if(vertexShader.shaderObject != 0) {
         glAttachShader(programObject, vertexShader.shaderObject);
@@ -141,10 +171,48 @@ void ShaderProgram::link() {
 
     glLinkProgram(programObject);
     checkLinkStatus();
+    cacheUniformLocations();
 
     CHECK_GL_ERRORS;
 }
 
+//------------------------------------------------------------------------------------
+/*
+ * Stores the location of every active uniform. Struct members are reported one by
+ * one (e.g. "lights[0].position"), but plain arrays only report their first element.
+ */
+void ShaderProgram::cacheUniformLocations() {
+    uniformLocations.clear();
+
+    GLint numUniforms = 0;
+    GLint maxNameLength = 0;
+    glGetProgramiv(programObject, GL_ACTIVE_UNIFORMS, &numUniforms);
+    glGetProgramiv(programObject, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+    vector<GLchar> nameBuffer(maxNameLength + 1);
+    for (GLint i = 0; i < numUniforms; i++) {
+        GLint size;
+        GLenum type;
+        glGetActiveUniform(programObject, i, nameBuffer.size(), nullptr, &size, &type, nameBuffer.data());
+        string name = nameBuffer.data();
+        uniformLocations[name] = glGetUniformLocation(programObject, name.c_str());
+
+        // arrays are reported as "name[0]", also store the bare name and every element
+        size_t bracket = name.rfind("[0]");
+        if (bracket == string::npos || bracket + 3 != name.size()) { continue; }
+        string base = name.substr(0, bracket);
+        uniformLocations[base] = uniformLocations[name];
+        for (GLint j = 1; j < size; j++) {
+            string element = base + "[" + to_string(j) + "]";
+            uniformLocations[element] = glGetUniformLocation(programObject, element.c_str());
+        }
+    }
+
+    // handles keep their index, only the location changes
+    for (int i = 0; i < handleNames.size(); i++) {
+        handleLocations[i] = getUniformLocation(handleNames[i].c_str());
+    }
+}
+
 //------------------------------------------------------------------------------------
 ShaderProgram::~ShaderProgram() {
     deleteShaders();
@@ -255,15 +323,91 @@ GLuint ShaderProgram::getProgramObject() const {
 GLint ShaderProgram::getUniformLocation (
 		const char * uniformName
 ) const {
-    GLint result = glGetUniformLocation(programObject, (const GLchar *)uniformName);
+    auto it = uniformLocations.find(uniformName);
 
-    if (result == -1) {
+    if (it == uniformLocations.end() || it->second == -1) {
         stringstream errorMessage;
         errorMessage << "Error obtaining uniform location: " << uniformName;
         throw ShaderException(errorMessage.str());
     }
 
-    return result;
+    return it->second;
+}
+
+//------------------------------------------------------------------------------------
+void ShaderProgram::bindUniformBlock (
+		const char * blockName,
+		GLuint bindingPoint
+) {
+    applyUniformBlockBinding(blockName, bindingPoint);
+    for (pair<string, GLuint> & binding : blockBindings) {
+        if (binding.first == blockName) {
+            binding.second = bindingPoint;
+            return;
+        }
+    }
+    blockBindings.push_back(make_pair(string(blockName), bindingPoint));
+}
+
+//------------------------------------------------------------------------------------
+void ShaderProgram::applyUniformBlockBinding (
+		const char * blockName,
+		GLuint bindingPoint
+) const {
+    GLuint blockIndex = glGetUniformBlockIndex(programObject, blockName);
+
+    if (blockIndex == GL_INVALID_INDEX) {
+        stringstream errorMessage;
+        errorMessage << "Error obtaining uniform block index: " << blockName;
+        throw ShaderException(errorMessage.str());
+    }
+
+    glUniformBlockBinding(programObject, blockIndex, bindingPoint);
+    CHECK_GL_ERRORS;
+}
+
+//------------------------------------------------------------------------------------
+bool ShaderProgram::hasUniform(const char * uniformName) const {
+    auto it = uniformLocations.find(uniformName);
+    return it != uniformLocations.end() && it->second != -1;
+}
+
+//------------------------------------------------------------------------------------
+/*
+ * Returns a handle to a uniform, to be used with setUniform.
+ */
+UniformHandle ShaderProgram::getUniformHandle (
+		const char * uniformName
+) {
+    for (int i = 0; i < handleNames.size(); i++) {
+        if (handleNames[i] == uniformName) { return i; }
+    }
+    // throws if the uniform does not exist
+    GLint location = getUniformLocation(uniformName);
+    handleNames.push_back(uniformName);
+    handleLocations.push_back(location);
+    return handleNames.size() - 1;
+}
+
+//------------------------------------------------------------------------------------
+void ShaderProgram::setUniform(UniformHandle handle, int value) const {
+    glUniform1i(handleLocations[handle], value);
+}
+
+void ShaderProgram::setUniform(UniformHandle handle, float value) const {
+    glUniform1f(handleLocations[handle], value);
+}
+
+void ShaderProgram::setUniform(UniformHandle handle, const glm::vec3 & value) const {
+    glUniform3fv(handleLocations[handle], 1, value_ptr(value));
+}
+
+void ShaderProgram::setUniform(UniformHandle handle, const glm::vec4 & value) const {
+    glUniform4fv(handleLocations[handle], 1, value_ptr(value));
+}
+
+void ShaderProgram::setUniform(UniformHandle handle, const glm::mat4 & value) const {
+    glUniformMatrix4fv(handleLocations[handle], 1, GL_FALSE, value_ptr(value));
 }
 
 //------------------------------------------------------------------------------------
@@ -5,22 +5,38 @@
 #pragma once
 
 #include "../OpenGLImport.hpp"
+#include <glm/glm.hpp>
 #include <string>
+#include <unordered_map>
+#include <vector>
+
+// Index of a uniform whose location is cached by a ShaderProgram.
+// Stays valid across recompileShaders.
+typedef int UniformHandle;
+
+// (name, value) pairs defined at the top of every stage, e.g. array sizes
+typedef std::vector<std::pair<std::string, int>> ShaderDefines;
 
 class ShaderProgram {
 public:
     ShaderProgram();
 
-    ~ShaderProgram();
+    virtual ~ShaderProgram();
 
     void generateProgramObject();
 
+    // must be called before attaching shaders
+    void setDefines(const ShaderDefines & defines);
+
     void attachVertexShader(std::string filePath);
     
     void attachFragmentShader(std::string filePath);
     
     void attachGeometryShader(std::string filePath);
 
+    // must be called before link, the outputs are written interleaved to one buffer
+    void setTransformFeedbackVaryings(const std::vector<const char *> & varyings);
+
     void link();
 
     void enable() const;
@@ -31,10 +47,27 @@ public:
 
     GLuint getProgramObject() const;
 
+    // looked up in a cache filled after linking, no driver call
     GLint getUniformLocation(const char * uniformName) const;
 
     GLint getAttribLocation(const char * attributeName) const;
 
+    // binds a std140 uniform block to the given binding point, kept across recompileShaders
+    void bindUniformBlock(const char * blockName, GLuint bindingPoint);
+
+    // false if the uniform is not declared or not active
+    bool hasUniform(const char * uniformName) const;
+
+    // resolve a uniform once, so the per frame path does no string work
+    UniformHandle getUniformHandle(const char * uniformName);
+
+    // typed setters, the program must be enabled
+    void setUniform(UniformHandle handle, int value) const;
+    void setUniform(UniformHandle handle, float value) const;
+    void setUniform(UniformHandle handle, const glm::vec3 & value) const;
+    void setUniform(UniformHandle handle, const glm::vec4 & value) const;
+    void setUniform(UniformHandle handle, const glm::mat4 & value) const;
+
 
 private:
     struct Shader {
@@ -47,6 +80,7 @@ private:
     Shader vertexShader;
     Shader fragmentShader;
     Shader geometryShader;
+    std::string defineLines;
 
     GLuint programObject;
     GLuint prevProgramObject;
@@ -65,5 +99,18 @@ private:
     void checkLinkStatus();
 
     void deleteShaders();
+
+    // location of every active uniform, rebuilt whenever the program is linked
+    std::unordered_map<std::string, GLint> uniformLocations;
+    // names and locations of the uniforms that have handles
+    std::vector<std::string> handleNames;
+    std::vector<GLint> handleLocations;
+
+    void cacheUniformLocations();
+
+    // linking resets the block bindings, so they are set again after recompiling
+    std::vector<std::pair<std::string, GLuint>> blockBindings;
+
+    void applyUniformBlockBinding(const char * blockName, GLuint bindingPoint) const;
 };
 
@@ -6,7 +6,13 @@
 #include "Shaders/ParticleShader.hpp"
 #include "Shaders/TextShader.hpp"
 #include "Shaders/ShadowShader.hpp"
+#include "Shaders/DepthPrepassShader.hpp"
 #include "Shaders/QuadShader.hpp"
 #include "Shaders/SkyboxShader.hpp"
 #include "Shaders/SpriteShader.hpp"
-#include "Shaders/ShapeShader.hpp"
\ No newline at end of file
+#include "Shaders/ShapeShader.hpp"
+#include "Shaders/SceneUniforms.hpp"
+#include "Shaders/TransparencyPass.hpp"
+#include "Shaders/GBufferShader.hpp"
+#include "Shaders/DeferredLightingPass.hpp"
+#include "Shaders/LanternFilterPass.hpp"
\ No newline at end of file
@@ -43,13 +43,14 @@ void ShadowShader::initMeshData(const MeshConsolidator & meshConsolidator) {
 
 glm::mat4 ShadowShader::getDirLightPerspectiveMatrix() { return dirLightPerspective; }
 
-bool ShadowShader::loadGeometryNodeData(GeometryNode* geometryNode, glm::mat4& fullT) {    
+bool ShadowShader::loadBucketData(const RenderBucket& bucket) {    
     // for now, translucent objects do not cast a shadow, so we do not draw
+	GeometryNode* geometryNode = bucket.node;
 	if (geometryNode->materialType == MaterialType::Plain && 
 		geometryNode->material.kd.a < 1 && transparencyEnabled) {
 		return false;
 	}
-	return SceneShader::loadGeometryNodeData(geometryNode, fullT);
+	return SceneShader::loadBucketData(bucket);
 } 
 
 glm::vec3 ShadowShader::getDirLightPosition(glm::vec3 viewPos, glm::vec3 lightDirection) {
@@ -22,7 +22,7 @@ class ShadowShader : public SceneShader {
 	bool transparencyEnabled;
 
     protected:
-        bool loadGeometryNodeData(GeometryNode* geometryNode, glm::mat4& fullT) override;
+        bool loadBucketData(const RenderBucket& bucket) override;
 
     public:
 		ShadowShader(BatchInfoMap* batchInfoMap_, float wW, float wH,
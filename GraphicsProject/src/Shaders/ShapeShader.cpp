@@ -4,15 +4,19 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <vector>
+#include <algorithm>
 
 // number of points that make the circle
 const int NUM_OPEN_CIRCLE_PTS = 48;
 const int NUM_FILL_CIRCLE_TRIANGLES = 48;
 const int NUM_OPEN_RECT_PTS = 4;
 const int NUM_FILL_RECT_TRIANGLES = 2;
+// room for this many graph points per stream region before it has to grow
+const size_t INITIAL_GRAPH_POINTS = 512;
 
 
-ShapeShader::ShapeShader(float wH, float wW) : ShaderProgram(), windowH(wH), windowW(wW)
+ShapeShader::ShapeShader(float wH, float wW) : ShaderProgram(), windowH(wH), windowW(wW),
+    graphStream(GL_ARRAY_BUFFER, INITIAL_GRAPH_POINTS * sizeof(glm::vec2))
 {
     generateProgramObject();
 	attachVertexShader( "Shape.vs" );
@@ -90,6 +94,13 @@ void ShapeShader::initData() {
         // "position" vertex attribute location for any bound vertex shader program.
         glVertexAttribPointer(positionAttribLocation, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
 
+        // the graph points are set when they are drawn
+        glGenVertexArrays(1, &graphVao);
+        glBindVertexArray(graphVao);
+        graphStream.initData();
+        positionLocation = positionAttribLocation;
+        glEnableVertexAttribArray(positionLocation);
+
         enable();
         {
             GLint location = getUniformLocation("P");
@@ -152,3 +163,33 @@ void ShapeShader::drawRect(float left, float bot, float w, float h, glm::vec3 co
 	CHECK_GL_ERRORS;
 }
 
+void ShapeShader::drawGraph(float left, float bot, float w, float h,
+    const std::vector<float>& values, float maxValue, glm::vec3 colour) {
+	if (values.size() < 2 || maxValue <= 0) { return; }
+
+	// points in the unit square, like the other shapes
+	graphPoints.resize(values.size());
+	for (int i = 0; i < values.size(); i++) {
+		float y = std::min(std::max(values[i] / maxValue, 0.0f), 1.0f);
+		graphPoints[i] = glm::vec2((float)i / (values.size() - 1), y);
+	}
+
+	glBindVertexArray(graphVao);
+	enable();
+	{
+		size_t start = graphStream.upload(graphPoints.data(), graphPoints.size() * sizeof(glm::vec2));
+		glBindBuffer(GL_ARRAY_BUFFER, graphStream.getBuffer());
+		glVertexAttribPointer(positionLocation, 2, GL_FLOAT, GL_FALSE, 0, (void*)start);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		glm::mat4 tM = glm::translate(glm::mat4(1), glm::vec3(left, bot, 0));
+		glm::mat4 M = glm::scale(tM, glm::vec3(w, h, 1.0));
+
+		glUniformMatrix4fv(getUniformLocation("M"), 1, GL_FALSE, value_ptr(M));
+		glUniform3fv(getUniformLocation("colour"), 1, value_ptr(colour));
+		glDrawArrays(GL_LINE_STRIP, 0, graphPoints.size());
+	}
+	disable();
+	glBindVertexArray(0);
+	CHECK_GL_ERRORS;
+}
@@ -1,5 +1,7 @@
 #pragma once
 #include "ShaderProgram.hpp"
+#include "StreamBuffer.hpp"
+#include <vector>
 
 class ShapeShader : public ShaderProgram {
 	GLuint vao;
@@ -11,6 +13,12 @@ class ShapeShader : public ShaderProgram {
     int openRectIndex;
     int fillRectIndex;
 
+    // line graphs change every frame, so their points are streamed
+    GLuint graphVao;
+    StreamBuffer graphStream;
+    GLint positionLocation;
+    std::vector<glm::vec2> graphPoints;
+
     public:
         ShapeShader(float wH, float wW);
         virtual void initData();
@@ -20,4 +28,7 @@ class ShapeShader : public ShaderProgram {
 			float r, glm::vec3 colour, bool fill);
 		void drawRect(float left, float bot,
 			float w, float h, glm::vec3 colour, bool fill);
+		// a line through the values, evenly spaced across the box. maxValue is at the top
+		void drawGraph(float left, float bot, float w, float h,
+			const std::vector<float>& values, float maxValue, glm::vec3 colour);
 };
\ No newline at end of file
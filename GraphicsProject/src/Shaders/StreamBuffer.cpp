@@ -0,0 +1,116 @@
+#include "StreamBuffer.hpp"
+#include "../Application/GlErrorCheck.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+StreamBuffer::StreamBuffer(GLenum target_, size_t regionSize_) :
+	target(target_), buffer(0), regionSize(regionSize_), region(0), regionUsed(0),
+	isPersistent(false), persistentPtr(nullptr), mappedOffset(0)
+{
+	for (int i = 0; i < NUM_STREAM_REGIONS; i++) { fences[i] = 0; }
+}
+
+StreamBuffer::~StreamBuffer() {
+	deleteFences();
+	glDeleteBuffers(1, &buffer);
+}
+
+void StreamBuffer::initData() {
+	// persistent mapping needs immutable storage
+	isPersistent = GLAD_GL_VERSION_4_4 != 0;
+	allocate(regionSize);
+}
+
+void StreamBuffer::allocate(size_t minRegionSize) {
+	regionSize = (std::max(minRegionSize, regionSize) + STREAM_ALIGNMENT - 1) & ~(STREAM_ALIGNMENT - 1);
+	region = 0;
+	regionUsed = 0;
+	deleteFences();
+
+	glBindBuffer(target, buffer);
+	if (isPersistent) {
+		// storage can not be resized, so start over with a new buffer
+		if (buffer != 0) {
+			glUnmapBuffer(target);
+			glDeleteBuffers(1, &buffer);
+		}
+		glGenBuffers(1, &buffer);
+		glBindBuffer(target, buffer);
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(target, NUM_STREAM_REGIONS * regionSize, nullptr, flags);
+		persistentPtr = (unsigned char*)glMapBufferRange(target, 0, NUM_STREAM_REGIONS * regionSize, flags);
+	} else {
+		// orphans the old storage, draws still using it keep their copy
+		if (buffer == 0) {
+			glGenBuffers(1, &buffer);
+			glBindBuffer(target, buffer);
+		}
+		glBufferData(target, NUM_STREAM_REGIONS * regionSize, nullptr, GL_STREAM_DRAW);
+	}
+	glBindBuffer(target, 0);
+	CHECK_GL_ERRORS;
+}
+
+void StreamBuffer::nextRegion() {
+	// everything read from this region has already been submitted
+	fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	region = (region + 1) % NUM_STREAM_REGIONS;
+	regionUsed = 0;
+
+	// the region was last filled two regions ago, so this rarely has to wait
+	if (fences[region] != 0) {
+		GLenum result = glClientWaitSync(fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+		while (result == GL_TIMEOUT_EXPIRED) {
+			result = glClientWaitSync(fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+		}
+		glDeleteSync(fences[region]);
+		fences[region] = 0;
+	}
+}
+
+void StreamBuffer::deleteFences() {
+	for (int i = 0; i < NUM_STREAM_REGIONS; i++) {
+		if (fences[i] != 0) {
+			glDeleteSync(fences[i]);
+			fences[i] = 0;
+		}
+	}
+}
+
+void* StreamBuffer::map(size_t bytes) {
+	bytes = std::max(bytes, (size_t)1);		// empty ranges can not be mapped
+	size_t start = (regionUsed + STREAM_ALIGNMENT - 1) & ~(STREAM_ALIGNMENT - 1);
+	if (bytes > regionSize) {
+		allocate(std::max(bytes, 2 * regionSize));
+		start = 0;
+	} else if (start + bytes > regionSize) {
+		nextRegion();
+		start = 0;
+	}
+	regionUsed = start + bytes;
+	mappedOffset = region * regionSize + start;
+
+	if (isPersistent) { return persistentPtr + mappedOffset; }
+	// the fences make sure the GPU is done with this range
+	glBindBuffer(target, buffer);
+	return glMapBufferRange(target, mappedOffset, bytes,
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+}
+
+void StreamBuffer::unmap() {
+	if (isPersistent) { return; }
+	glUnmapBuffer(target);
+	glBindBuffer(target, 0);
+}
+
+size_t StreamBuffer::upload(const void* data, size_t bytes) {
+	void* ptr = map(bytes);
+	if (bytes > 0) { memcpy(ptr, data, bytes); }
+	unmap();
+	return mappedOffset;
+}
+
+GLuint StreamBuffer::getBuffer() { return buffer; }
+
+size_t StreamBuffer::getOffset() { return mappedOffset; }
@@ -0,0 +1,48 @@
+#pragma once
+#include "../OpenGLImport.hpp"
+#include <cstddef>
+
+// the ring is split in three so the CPU can fill one region while the GPU reads the others
+const int NUM_STREAM_REGIONS = 3;
+// every range starts on this boundary, enough for any vertex attribute
+const size_t STREAM_ALIGNMENT = 64;
+
+// A buffer for data that is rewritten every frame, such as per instance attributes.
+// Ranges are handed out one after another around a ring of regions. A fence is placed
+// when a region fills up, and the region is only written again once that fence has
+// passed, so mapping never has to wait on draws that are still reading older data.
+// With GL 4.4 the buffer stays mapped for its whole life, otherwise every range
+// is mapped unsynchronized
+class StreamBuffer {
+	GLenum target;
+	GLuint buffer;
+	size_t regionSize;
+	int region;					// the region being written
+	size_t regionUsed;
+	GLsync fences[NUM_STREAM_REGIONS];
+
+	bool isPersistent;
+	unsigned char* persistentPtr;
+	size_t mappedOffset;		// start of the last range handed out
+
+	// makes a new buffer with room for at least minRegionSize in each region
+	void allocate(size_t minRegionSize);
+	void nextRegion();
+	void deleteFences();
+
+	public:
+		StreamBuffer(GLenum target_, size_t regionSize_);
+		~StreamBuffer();
+		void initData();
+
+		// reserves bytes and returns where to write them, unmap before drawing from them
+		void* map(size_t bytes);
+		void unmap();
+		// copies the data into the next range, returns its offset in the buffer
+		size_t upload(const void* data, size_t bytes);
+
+		// the buffer may be replaced when a range does not fit in a region,
+		// so attribute pointers should be set after mapping
+		GLuint getBuffer();
+		size_t getOffset();
+};
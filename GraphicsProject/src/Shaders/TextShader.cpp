@@ -1,15 +1,121 @@
 #include "TextShader.hpp"
 #include "../Application/CS488Window.hpp"
+#include "../Application/GlErrorCheck.hpp"
 #include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <fstream>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/io.hpp>
 #include <glm/gtx/string_cast.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+// text sizes are relative to this, a scale of 1 is a 48 pixel font
 const int FONT_SIZE = 48;
+// glyphs are stored this big in the atlas, the distance field makes them sharp when scaled up
+const int SDF_GLYPH_SIZE = 32;
+// distances are measured on a glyph this many times bigger, then averaged down
+const int SDF_SUPERSAMPLE = 4;
+// atlas pixels from the edge of a glyph before the distance is clamped
+const int SDF_SPREAD = 4;
+// the width of outlines, in pixels at FONT_SIZE. has to fit in the spread
+const float OUTLINE_WIDTH = 3;
+// glyphs are packed in rows across the atlas, with a gap so filtering does not bleed
+const int ATLAS_WIDTH = 512;
+const int ATLAS_PADDING = 1;
+// room for this many glyphs per stream region before it has to grow
+const size_t INITIAL_GLYPH_QUADS = 256;
+// the cache is emptied when it gets this big, so changing text can not grow it forever
+const size_t MAX_CACHED_LAYOUTS = 64;
+// bump this when the atlas format changes so old caches are rebuilt
+const int ATLAS_CACHE_VERSION = 1;
+
+namespace {
+    struct AtlasCacheHeader {
+        char magic[4];
+        int version;
+        int glyphSize;
+        int spread;
+        int supersample;
+        long long fontBytes;     // the cache is stale if the font changed
+        int atlasWidth;
+        int atlasHeight;
+        int numCharacters;
+    };
+
+    long long getFileSize(const std::string& path) {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file) { return -1; }
+        return (long long)file.tellg();
+    }
+
+    AtlasCacheHeader makeHeader(long long fontBytes, int atlasHeight, int numCharacters) {
+        AtlasCacheHeader header = {
+            { 'S', 'D', 'F', 'A' }, ATLAS_CACHE_VERSION, SDF_GLYPH_SIZE, SDF_SPREAD,
+            SDF_SUPERSAMPLE, fontBytes, ATLAS_WIDTH, atlasHeight, numCharacters
+        };
+        return header;
+    }
+
+    // true if the cache was made from this font with these settings
+    bool isCurrent(const AtlasCacheHeader& header, long long fontBytes) {
+        AtlasCacheHeader expected = makeHeader(fontBytes, 0, 0);
+        return memcmp(header.magic, expected.magic, sizeof(header.magic)) == 0 &&
+            header.version == expected.version && header.glyphSize == expected.glyphSize &&
+            header.spread == expected.spread && header.supersample == expected.supersample &&
+            header.fontBytes == expected.fontBytes && header.atlasWidth == expected.atlasWidth;
+    }
+
+    // squared distance for pixels that are not features, finite so the maths below stays finite
+    const float FAR_AWAY = 1e20f;
+
+    // 1D squared distance transform of Felzenszwalb and Huttenlocher.
+    // f is 0 at feature pixels and FAR_AWAY everywhere else
+    void distanceTransform1D(const float* f, float* d, int n, int* v, float* z) {
+        int k = 0;
+        v[0] = 0;
+        z[0] = -INFINITY;
+        z[1] = INFINITY;
+        for (int q = 1; q < n; q++) {
+            float s = ((f[q] + q*q) - (f[v[k]] + v[k]*v[k])) / (2*q - 2*v[k]);
+            while (s <= z[k]) {
+                k--;
+                s = ((f[q] + q*q) - (f[v[k]] + v[k]*v[k])) / (2*q - 2*v[k]);
+            }
+            k++;
+            v[k] = q;
+            z[k] = s;
+            z[k+1] = INFINITY;
+        }
+        k = 0;
+        for (int q = 0; q < n; q++) {
+            while (z[k+1] < q) { k++; }
+            d[q] = (q - v[k])*(q - v[k]) + f[v[k]];
+        }
+    }
+
+    // replaces every pixel with its squared distance to the nearest feature pixel
+    void distanceTransform(std::vector<float>& grid, int w, int h) {
+        int n = std::max(w, h);
+        std::vector<float> f(n), d(n), z(n + 1);
+        std::vector<int> v(n);
+        for (int x = 0; x < w; x++) {
+            for (int y = 0; y < h; y++) { f[y] = grid[y*w + x]; }
+            distanceTransform1D(f.data(), d.data(), h, v.data(), z.data());
+            for (int y = 0; y < h; y++) { grid[y*w + x] = d[y]; }
+        }
+        for (int y = 0; y < h; y++) {
+            distanceTransform1D(&grid[y*w], d.data(), w, v.data(), z.data());
+            memcpy(&grid[y*w], d.data(), w*sizeof(float));
+        }
+    }
+}
 
 TextShader::TextShader(std::string fontFile_, float wH, float wW)
-    : ShaderProgram(),  windowH(wH), windowW(wW) {
+    : ShaderProgram(), atlasTexture(0),
+    vertexStream(GL_ARRAY_BUFFER, INITIAL_GLYPH_QUADS * 6 * sizeof(TextVertex)),
+    windowH(wH), windowW(wW) {
     generateProgramObject();
 	attachVertexShader( "Text.vs" );
 	attachFragmentShader( "Text.fs" );
@@ -18,28 +124,42 @@ TextShader::TextShader(std::string fontFile_, float wH, float wW)
 	fontFile = CS488Window::getAssetFilePath(
 		("Fonts/" + fontFile_).c_str()
 	).c_str();
+    cacheFile = fontFile + ".sdf";
 }
 
-void TextShader::initData() {
+TextShader::~TextShader() {
+    glDeleteTextures(1, &atlasTexture);
+}
+
+bool TextShader::generateAtlas(std::vector<unsigned char>& atlas, int& atlasHeight) {
     // first try to load library and load the font file
     FT_Library ft;
     if (FT_Init_FreeType(&ft))
     {
         std::cout << "Error: Cannot Init FreeType Library" << std::endl;
-        return;
+        return false;
     }
 
     FT_Face face;
     if (FT_New_Face(ft, fontFile.c_str(), 0, &face))
     {
         std::cout << "Error: Cannot load font " << fontFile << std::endl;  
-        return;
+        FT_Done_FreeType(ft);
+        return false;
     }
 
-    FT_Set_Pixel_Sizes(face, 0, FONT_SIZE); 
+    const int S = SDF_SUPERSAMPLE;
+    const int border = SDF_SPREAD * S;                 // room around the big glyph for the field
+    const float toFont = (float)FONT_SIZE / SDF_GLYPH_SIZE;
+    FT_Set_Pixel_Sizes(face, 0, SDF_GLYPH_SIZE * S); 
 
-    // load the texture of all 128 character (no unicode) to the map
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // disable byte-alignment restriction
+    // make a distance field for all 128 characters (no unicode) and find a place for each in the atlas
+    std::vector<std::vector<unsigned char>> fields(128);
+    std::vector<glm::ivec2> fieldSize(128, glm::ivec2(0));
+    std::vector<glm::ivec2> atlasPos(128);
+    int penX = ATLAS_PADDING;
+    int penY = ATLAS_PADDING;
+    int rowHeight = 0;
     for (unsigned char c = 0; c < 128; c++)
     {
         // load character glyph 
@@ -48,106 +168,254 @@ void TextShader::initData() {
             std::cout << "ERROR::FREETYTPE: Failed to load Glyph" << std::endl;
             continue;
         }
-        // generate texture
-        unsigned int texture;
-        glGenTextures(1, &texture);
-        glBindTexture(GL_TEXTURE_2D, texture);
-        glTexImage2D(
-            GL_TEXTURE_2D,
-            0,
-            GL_RED,
-            face->glyph->bitmap.width,
-            face->glyph->bitmap.rows,
-            0,
-            GL_RED,
-            GL_UNSIGNED_BYTE,
-            face->glyph->bitmap.buffer
-        );
-        // set texture options
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        // now store character for later use
+        FT_Bitmap& bitmap = face->glyph->bitmap;
+        int bw = bitmap.width;
+        int bh = bitmap.rows;
+        // size in the atlas, the big glyph plus its border rounded up to whole atlas pixels
+        int w = (bw + 2*border + S - 1) / S;
+        int h = (bh + 2*border + S - 1) / S;
+        int bigW = w * S;
+        int bigH = h * S;
+
+        // distance to the nearest pixel inside and outside the glyph
+        std::vector<float> toInside(bigW * bigH, FAR_AWAY);
+        std::vector<float> toOutside(bigW * bigH, FAR_AWAY);
+        std::vector<bool> inside(bigW * bigH, false);
+        for (int y = 0; y < bigH; y++) {
+            for (int x = 0; x < bigW; x++) {
+                int bx = x - border;
+                int by = y - border;
+                int i = y*bigW + x;
+                inside[i] = bx >= 0 && bx < bw && by >= 0 && by < bh &&
+                    bitmap.buffer[by * bitmap.pitch + bx] >= 128;
+                (inside[i] ? toInside : toOutside)[i] = 0;
+            }
+        }
+        distanceTransform(toInside, bigW, bigH);
+        distanceTransform(toOutside, bigW, bigH);
+
+        // average the signed distance over each atlas pixel, 0.5 is the edge of the glyph
+        fields[c].resize(w * h);
+        for (int y = 0; y < h; y++) {
+            for (int x = 0; x < w; x++) {
+                float sum = 0;
+                for (int sy = 0; sy < S; sy++) {
+                    for (int sx = 0; sx < S; sx++) {
+                        int i = (y*S + sy)*bigW + x*S + sx;
+                        sum += inside[i] ? sqrt(toOutside[i]) - 0.5f : 0.5f - sqrt(toInside[i]);
+                    }
+                }
+                float dist = sum / (S*S*S);
+                float value = glm::clamp(0.5f + dist / (2*SDF_SPREAD), 0.0f, 1.0f);
+                fields[c][y*w + x] = (unsigned char)(value * 255 + 0.5f);
+            }
+        }
+        fieldSize[c] = glm::ivec2(w, h);
+
+        // start a new row when this one is full
+        if (penX + w + ATLAS_PADDING > ATLAS_WIDTH) {
+            penX = ATLAS_PADDING;
+            penY += rowHeight + ATLAS_PADDING;
+            rowHeight = 0;
+        }
+        atlasPos[c] = glm::ivec2(penX, penY);
+        penX += w + ATLAS_PADDING;
+        rowHeight = std::max(rowHeight, h);
+
+        // freetype measures the big glyph, convert to FONT_SIZE pixels
         Character character = {
-            texture, 
-            glm::ivec2(face->glyph->bitmap.width, face->glyph->bitmap.rows),
-            glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top),
-            (unsigned int) (face->glyph->advance.x)
+            glm::vec4(0),
+            glm::vec2(w, h) * toFont,
+            glm::vec2(face->glyph->bitmap_left - border, face->glyph->bitmap_top + border) / (float)S * toFont,
+            (face->glyph->advance.x >> 6) / (float)S * toFont
         };
         characters[c] = character;
     }
+    atlasHeight = penY + rowHeight + ATLAS_PADDING;
 
     // done processing, free resources
     FT_Done_Face(face);
     FT_Done_FreeType(ft);
 
-	// initialize the vba and vao, same as the spriteShader
-    float vertices[6][2] = {                               
-        { 0.0f, 0.0f }, { 0.0f, 1.0f }, { 1.0f, 1.0f },
-        { 0.0f, 0.0f }, { 1.0f, 1.0f }, { 1.0f, 0.0f }           
-    };
+    // copy every glyph into place, the top row of a field is the top of the glyph
+    atlas.assign(ATLAS_WIDTH * atlasHeight, 0);
+    for (auto& entry : characters) {
+        unsigned char c = entry.first;
+        Character& ch = entry.second;
+        glm::ivec2 p = atlasPos[c];
+        glm::ivec2 size = fieldSize[c];
+        for (int row = 0; row < size.y; row++) {
+            memcpy(&atlas[(p.y + row) * ATLAS_WIDTH + p.x], &fields[c][row * size.x], size.x);
+        }
+        ch.uvRect = glm::vec4(
+            (float)p.x / ATLAS_WIDTH, (float)p.y / atlasHeight,
+            (float)(p.x + size.x) / ATLAS_WIDTH, (float)(p.y + size.y) / atlasHeight);
+    }
+    return true;
+}
+
+bool TextShader::loadAtlas(std::vector<unsigned char>& atlas, int& atlasHeight) {
+    std::ifstream file(cacheFile, std::ios::binary);
+    if (!file) { return false; }
+
+    AtlasCacheHeader header;
+    file.read((char*)&header, sizeof(header));
+    if (!file || !isCurrent(header, getFileSize(fontFile)) ||
+        header.atlasHeight <= 0 || header.numCharacters > 128) {
+        return false;
+    }
+
+    std::map<char, Character> loaded;
+    for (int i = 0; i < header.numCharacters; i++) {
+        char c;
+        Character ch;
+        file.read(&c, sizeof(c));
+        file.read((char*)&ch, sizeof(ch));
+        loaded[c] = ch;
+    }
+    atlasHeight = header.atlasHeight;
+    atlas.resize(ATLAS_WIDTH * atlasHeight);
+    file.read((char*)atlas.data(), atlas.size());
+    if (!file) { return false; }
+
+    characters = loaded;
+    return true;
+}
+
+void TextShader::saveAtlas(const std::vector<unsigned char>& atlas, int atlasHeight) {
+    std::ofstream file(cacheFile, std::ios::binary | std::ios::trunc);
+    AtlasCacheHeader header = makeHeader(getFileSize(fontFile), atlasHeight, characters.size());
+    file.write((const char*)&header, sizeof(header));
+    for (auto& entry : characters) {
+        file.write(&entry.first, sizeof(entry.first));
+        file.write((const char*)&entry.second, sizeof(entry.second));
+    }
+    file.write((const char*)atlas.data(), atlas.size());
+    if (!file) {
+        std::cout << "Warning: Cannot write font cache " << cacheFile << std::endl;
+    }
+}
+
+void TextShader::initData() {
+    // the distance field is slow to make, so it is only made when there is no usable cache
+    std::vector<unsigned char> atlas;
+    int atlasHeight = 0;
+    if (!loadAtlas(atlas, atlasHeight)) {
+        if (!generateAtlas(atlas, atlasHeight)) { return; }
+        saveAtlas(atlas, atlasHeight);
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // disable byte-alignment restriction
+    glGenTextures(1, &atlasTexture);
+    glBindTexture(GL_TEXTURE_2D, atlasTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, ATLAS_WIDTH, atlasHeight, 0, GL_RED, GL_UNSIGNED_BYTE, atlas.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+	// initialize the vao, the vertices are streamed in by flush
     glGenVertexArrays(1, &m_vao_text);
     glBindVertexArray(m_vao_text);
-	GLuint m_vbo_text;
-	glGenBuffers(1, &m_vbo_text);
-    glBindBuffer(GL_ARRAY_BUFFER, m_vbo_text);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6 * 2, &vertices[0], GL_STATIC_DRAW);
-    GLint posLocation = getAttribLocation("pos");
+    vertexStream.initData();
+    posLocation = getAttribLocation("pos");
     glEnableVertexAttribArray(posLocation);
-    glVertexAttribPointer(posLocation, 2, GL_FLOAT, GL_FALSE, 0, 0);
+    uvLocation = getAttribLocation("uv");
+    glEnableVertexAttribArray(uvLocation);
+    colourLocation = getAttribLocation("colour");
+    glEnableVertexAttribArray(colourLocation);
+    outlineLocation = getAttribLocation("outline");
+    glEnableVertexAttribArray(outlineLocation);
     
-	// set the projection matrix
+	// set the projection matrix and the outline width in distance field units
     enable();
     {
         GLint location = getUniformLocation("P");
         glm::mat4 P = glm::ortho(0.0f, windowW, 0.0f, windowH);
         glUniformMatrix4fv(location, 1, GL_FALSE, value_ptr(P));
+        glUniform1i(getUniformLocation("text"), 0);
+        float outlineTexels = OUTLINE_WIDTH * SDF_GLYPH_SIZE / FONT_SIZE;
+        glUniform1f(getUniformLocation("outlineWidth"), outlineTexels / (2*SDF_SPREAD));
     }
     disable();
     
     // unbind
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);  
+    CHECK_GL_ERRORS;
 }
 
-void TextShader::renderText(
-    std::string text, float x, float y, float scale, glm::vec4 colour    
-) {
+const std::vector<glm::vec4>& TextShader::getLayout(const std::string& text, float scale) {
+    std::string key = text;
+    key.append((const char*)&scale, sizeof(float));
+    auto cached = layoutCache.find(key);
+    if (cached != layoutCache.end()) { return cached->second; }
+
+    if (layoutCache.size() >= MAX_CACHED_LAYOUTS) { layoutCache.clear(); }
+    std::vector<glm::vec4>& layout = layoutCache[key];
+    float adv = 0;						// position of next char to draw
+    for (int i=0; i<text.length(); i++) {
+        const Character& ch = characters[text[i]];
+        float w = ch.size.x*scale;
+        float h = ch.size.y*scale;
+
+        float xpos = adv + ch.bearing.x*scale;
+        float ypos = -(ch.size.y - ch.bearing.y)*scale;
+
+        // two triangles, the bottom of the quad is the bottom of the glyph
+        glm::vec4 uv = ch.uvRect;
+        layout.push_back(glm::vec4(xpos, ypos, uv.x, uv.w));
+        layout.push_back(glm::vec4(xpos, ypos + h, uv.x, uv.y));
+        layout.push_back(glm::vec4(xpos + w, ypos + h, uv.z, uv.y));
+        layout.push_back(glm::vec4(xpos, ypos, uv.x, uv.w));
+        layout.push_back(glm::vec4(xpos + w, ypos + h, uv.z, uv.y));
+        layout.push_back(glm::vec4(xpos + w, ypos, uv.z, uv.w));
+        adv += ch.advance*scale;
+    }
+    return layout;
+}
+
+void TextShader::queueText(const std::string& text, float x, float y, float scale, glm::vec4 colour,
+    glm::vec4 outline) {
+    if (colour.a <= 0 && outline.a <= 0) { return; }
+    const std::vector<glm::vec4>& layout = getLayout(text, scale);
+    for (const glm::vec4& v : layout) {
+        textVertices.push_back({ glm::vec2(v.x + x, v.y + y), glm::vec2(v.z, v.w), colour, outline });
+    }
+}
+
+void TextShader::flush() {
+    if (textVertices.empty()) { return; }
     enable();
     {
         glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, atlasTexture);
         glBindVertexArray(m_vao_text);
 
-        GLint location = getUniformLocation("textColor");
-        glUniform4fv(location, 1, value_ptr(colour));
-        
-        float widthScaleFactor = scale;
-        float heightScaleFactor = scale; 
-        float adv = x;						// position of next char to draw
-		// draw character by character
-        for (int i=0; i<text.length(); i++) {
-            Character ch = characters[text[i]];
-            float xScale = ch.size.x*widthScaleFactor;
-            float yScale = ch.size.y*heightScaleFactor;
-
-            float xpos = adv + ch.bearing.x*widthScaleFactor;
-            float ypos = y - (ch.size.y - ch.bearing.y)*heightScaleFactor;
-
-            glm::mat4 tM = glm::translate(glm::mat4(1), glm::vec3(xpos, ypos, 0));
-            glm::mat4 M = glm::scale(tM, glm::vec3(xScale, yScale, 1.0));
-
-            GLint location = getUniformLocation("M");
-            glUniformMatrix4fv(location, 1, GL_FALSE, value_ptr(M));
-        
-            glBindTexture(GL_TEXTURE_2D, ch.textureID);
-
-            glDrawArrays(GL_TRIANGLES, 0, 6);
-            adv += (ch.advance >> 6)*widthScaleFactor;
-        }
+        size_t start = vertexStream.upload(textVertices.data(), textVertices.size() * sizeof(TextVertex));
+        glBindBuffer(GL_ARRAY_BUFFER, vertexStream.getBuffer());
+        glVertexAttribPointer(posLocation, 2, GL_FLOAT, GL_FALSE, sizeof(TextVertex),
+            (void*)(start + offsetof(TextVertex, pos)));
+        glVertexAttribPointer(uvLocation, 2, GL_FLOAT, GL_FALSE, sizeof(TextVertex),
+            (void*)(start + offsetof(TextVertex, uv)));
+        glVertexAttribPointer(colourLocation, 4, GL_FLOAT, GL_FALSE, sizeof(TextVertex),
+            (void*)(start + offsetof(TextVertex, colour)));
+        glVertexAttribPointer(outlineLocation, 4, GL_FLOAT, GL_FALSE, sizeof(TextVertex),
+            (void*)(start + offsetof(TextVertex, outline)));
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        glDrawArrays(GL_TRIANGLES, 0, textVertices.size());
 
         glBindVertexArray(0);
         glBindTexture(GL_TEXTURE_2D, 0);
     }
     disable();
-}
\ No newline at end of file
+    textVertices.clear();
+}
+
+void TextShader::renderText(
+    std::string text, float x, float y, float scale, glm::vec4 colour    
+) {
+    queueText(text, x, y, scale, colour);
+    flush();
+}
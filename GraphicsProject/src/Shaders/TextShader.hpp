@@ -1,29 +1,70 @@
 #pragma once
 #include "ShaderProgram.hpp"
+#include "StreamBuffer.hpp"
 
 #include <glm/glm.hpp>
 #include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
 #include <freetype/ft2build.h>
 #include FT_FREETYPE_H 
 
+// metrics are in pixels at FONT_SIZE, and include the distance field border
 struct Character {
-    unsigned int textureID;  // ID handle of the glyph texture
-    glm::ivec2   size;       // Size of glyph
-    glm::ivec2   bearing;    // Offset from baseline to left/top of glyph
-    unsigned int advance;    // Offset to advance to next glyph
+    glm::vec4    uvRect;     // left, top, right, bottom of the glyph in the atlas
+    glm::vec2    size;       // Size of glyph
+    glm::vec2    bearing;    // Offset from baseline to left/top of glyph
+    float        advance;    // Offset to advance to next glyph
 };
 
+struct TextVertex {
+    glm::vec2 pos;
+    glm::vec2 uv;
+    glm::vec4 colour;
+    glm::vec4 outline;
+};
+
+// All the glyphs live in one signed distance field atlas, so text is sharp at
+// any scale. Text is queued up as vertices and a whole frame of it is drawn in one call
 class TextShader : public ShaderProgram {
     std::string fontFile;
+    std::string cacheFile;
     std::map<char, Character> characters;
+    GLuint atlasTexture;
+
+    // builds the distance field atlas from the font, slow so it is cached to disk
+    bool generateAtlas(std::vector<unsigned char>& atlas, int& atlasHeight);
+    bool loadAtlas(std::vector<unsigned char>& atlas, int& atlasHeight);
+    void saveAtlas(const std::vector<unsigned char>& atlas, int atlasHeight);
 
 	GLuint m_vao_text;
+    StreamBuffer vertexStream;
+    std::vector<TextVertex> textVertices;       // queued since the last flush
+    GLint posLocation;
+    GLint uvLocation;
+    GLint colourLocation;
+    GLint outlineLocation;
+
+    // glyph quads of recent strings laid out at the origin, as position and uv.
+    // keyed by the string and scale, most HUD text is the same every frame
+    std::unordered_map<std::string, std::vector<glm::vec4>> layoutCache;
+    const std::vector<glm::vec4>& getLayout(const std::string& text, float scale);
+
     float windowH;
     float windowW;
 
     public:
         // only support 1 font for now
         TextShader(std::string fontFile, float wH, float wW);
+        ~TextShader();
         void initData();
+        // adds the text to the batch, nothing is drawn until flush
+        // an outline is drawn around the text if its colour is not transparent
+        void queueText(const std::string& text, float x, float y, float scale, glm::vec4 colour,
+            glm::vec4 outline = glm::vec4(0));
+        // draws everything queued in one call
+        void flush();
+        // queues the text and draws it straight away
         void renderText(std::string text, float x, float y, float scale, glm::vec4 colour);
-};
\ No newline at end of file
+};
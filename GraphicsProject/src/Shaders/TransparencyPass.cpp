@@ -0,0 +1,124 @@
+#include "TransparencyPass.hpp"
+#include "../Application/GlErrorCheck.hpp"
+
+// texture units for the composite, nothing else is bound while it runs
+const int ACCUM_TEXTURE_UNIT = 0;
+const int WEIGHT_TEXTURE_UNIT = 1;
+
+TransparencyPass::TransparencyPass(int w, int h) :
+	width(w), height(h), isSupported(false), prevFramebuffer(0)
+{
+	generateProgramObject();
+	attachVertexShader("Quad.vs");
+	attachFragmentShader("OITComposite.fs");
+	link();
+	accumUniform = getUniformHandle("accum");
+	weightUniform = getUniformHandle("weights");
+}
+
+TransparencyPass::~TransparencyPass() {
+	glDeleteFramebuffers(1, &fbo);
+	glDeleteTextures(1, &accumTexture);
+	glDeleteTextures(1, &weightTexture);
+	glDeleteRenderbuffers(1, &depthBuffer);
+	glDeleteVertexArrays(1, &quadVao);
+	glDeleteBuffers(1, &quadVbo);
+}
+
+void TransparencyPass::initData() {
+	// the sums need more range than 8 bits, the composite reads them with texelFetch
+	glGenTextures(1, &accumTexture);
+	glBindTexture(GL_TEXTURE_2D, accumTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_HALF_FLOAT, nullptr);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glGenTextures(1, &weightTexture);
+	glBindTexture(GL_TEXTURE_2D, weightTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R16F, width, height, 0, GL_RED, GL_HALF_FLOAT, nullptr);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	// same format as the default framebuffer, so the depth can be blitted across
+	glGenRenderbuffers(1, &depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, accumTexture, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, weightTexture, 0);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+	GLenum drawBuffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+	glDrawBuffers(2, drawBuffers);
+	isSupported = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	// full screen quad for the composite, the texture coordinates are not needed
+	// since the targets are read a pixel at a time
+	float quadVertices[] = {
+		-1.0f,  1.0f, 0.0f,
+		-1.0f, -1.0f, 0.0f,
+		 1.0f,  1.0f, 0.0f,
+		 1.0f, -1.0f, 0.0f,
+	};
+	glGenVertexArrays(1, &quadVao);
+	glBindVertexArray(quadVao);
+	glGenBuffers(1, &quadVbo);
+	glBindBuffer(GL_ARRAY_BUFFER, quadVbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), quadVertices, GL_STATIC_DRAW);
+	GLint posLocation = getAttribLocation("aPos");
+	glEnableVertexAttribArray(posLocation);
+	glVertexAttribPointer(posLocation, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+	CHECK_GL_ERRORS;
+}
+
+void TransparencyPass::begin() {
+	// translucent fragments are still hidden by opaque ones, but never hide each other
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &prevFramebuffer);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, prevFramebuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbo);
+	glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+
+	// no colour, full revealage, no weight
+	GLfloat clearAccum[] = { 0, 0, 0, 1 };
+	GLfloat clearWeight[] = { 0, 0, 0, 0 };
+	glClearBufferfv(GL_COLOR, 0, clearAccum);
+	glClearBufferfv(GL_COLOR, 1, clearWeight);
+
+	glDepthMask(GL_FALSE);
+	glBlendFuncSeparate(GL_ONE, GL_ONE, GL_ZERO, GL_ONE_MINUS_SRC_ALPHA);
+	CHECK_GL_ERRORS;
+}
+
+void TransparencyPass::composite() {
+	glBindFramebuffer(GL_FRAMEBUFFER, prevFramebuffer);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glDisable(GL_DEPTH_TEST);
+
+	glBindVertexArray(quadVao);
+	enable();
+	{
+		setUniform(accumUniform, ACCUM_TEXTURE_UNIT);
+		setUniform(weightUniform, WEIGHT_TEXTURE_UNIT);
+		glActiveTexture(GL_TEXTURE0 + ACCUM_TEXTURE_UNIT);
+		glBindTexture(GL_TEXTURE_2D, accumTexture);
+		glActiveTexture(GL_TEXTURE0 + WEIGHT_TEXTURE_UNIT);
+		glBindTexture(GL_TEXTURE_2D, weightTexture);
+		glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		glActiveTexture(GL_TEXTURE0);
+	}
+	disable();
+	glBindVertexArray(0);
+
+	glEnable(GL_DEPTH_TEST);
+	glDepthMask(GL_TRUE);
+	CHECK_GL_ERRORS;
+}
+
+bool TransparencyPass::getIsSupported() { return isSupported; }
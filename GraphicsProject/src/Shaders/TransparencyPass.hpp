@@ -0,0 +1,44 @@
+#pragma once
+#include "ShaderProgram.hpp"
+
+enum class TransparencyMode {
+	Sorted,				// translucent objects and particles are sorted back to front every frame
+	WeightedBlended		// order independent, accumulated then composited in one pass
+};
+
+// Weighted blended order independent transparency (McGuire and Bavoil 2013).
+// Translucent fragments add their colour, weighted by alpha and depth, into an
+// accumulation target and multiply their coverage into the revealage, which is
+// kept in the accumulation alpha. The weights are summed in a second target.
+// The composite divides by the weight sum and blends the result over the opaque scene.
+// GL 3.3 has no per target blend funcs, so both targets use
+// glBlendFuncSeparate(ONE, ONE, ZERO, ONE_MINUS_SRC_ALPHA)
+class TransparencyPass : public ShaderProgram {
+	int width, height;
+	bool isSupported;
+
+	GLuint fbo;
+	GLuint accumTexture;		// rgb: weighted premultiplied colour, a: revealage
+	GLuint weightTexture;		// r: sum of the weights
+	GLuint depthBuffer;			// copy of the opaque depth, only tested against
+	GLint prevFramebuffer;
+
+	GLuint quadVao;
+	GLuint quadVbo;
+	UniformHandle accumUniform;
+	UniformHandle weightUniform;
+
+	public:
+		TransparencyPass(int w, int h);
+		~TransparencyPass();
+		void initData();
+
+		// copies the depth of the bound framebuffer and starts accumulating,
+		// translucent draws go between begin and composite
+		void begin();
+		// blends the translucent layer over the framebuffer that was bound at begin
+		void composite();
+
+		// false if the accumulation framebuffer could not be created
+		bool getIsSupported();
+};
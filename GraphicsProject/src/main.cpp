@@ -1,9 +1,16 @@
 #include "Project.hpp"
 
+#include <cstring>
+
 int main( int argc, char **argv ) 
 {
     std::string title("Bjon Li - CS488 Final Project");
-    CS488Window::launch(argc, argv, new Project(), 1024, 768, title);
+    // pass --deferred to light the opaque objects from a G-buffer
+    RenderPath renderPath = RenderPath::Forward;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--deferred") == 0) { renderPath = RenderPath::Deferred; }
+    }
+    CS488Window::launch(argc, argv, new Project(renderPath), 1024, 768, title);
 
 	return 0;
 }